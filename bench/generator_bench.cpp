@@ -0,0 +1,117 @@
+// Compares pulling search events through the coroutine generator with the plain stepping loop.
+// Both drive the same Search::Step(), so the difference is the cost of the coroutine machinery.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "grid.hpp"
+#include "search.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+OccupancyGrid MakeGrid(int size, double density, unsigned seed) {
+    OccupancyGrid grid(size, size);
+    std::mt19937 rng(seed);
+    std::bernoulli_distribution obstacle(density);
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            grid.SetObstacle(x, y, obstacle(rng));
+        }
+    }
+    // Keep the corners open so start and goal aren't walled in right away
+    for (int y = 0; y < 3; ++y) {
+        for (int x = 0; x < 3; ++x) {
+            grid.SetObstacle(x, y, false);
+            grid.SetObstacle(size - 1 - x, size - 1 - y, false);
+        }
+    }
+    return grid;
+}
+
+// Folds every event into a checksum so the consumer can't be optimized away
+struct Consumer {
+    std::uint64_t events = 0;
+    std::uint64_t checksum = 0;
+    void operator()(const SearchEvent& event) {
+        ++events;
+        checksum += static_cast<std::uint64_t>(event.at.x) * 31 + event.at.y + static_cast<int>(event.type);
+    }
+};
+
+double Median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+double RunLoop(Search& search, Algorithm algorithm, const GridSnapshot& grid, Coordinates start, Coordinates goal,
+               Consumer& consumer) {
+    const auto begin = Clock::now();
+    std::vector<SearchEvent> events;
+    search.Begin(algorithm, grid, start, goal);
+    while (!search.IsDone()) {
+        events.clear();
+        search.Step(1, events);
+        for (const auto& event : events) {
+            consumer(event);
+        }
+    }
+    return std::chrono::duration<double, std::micro>(Clock::now() - begin).count();
+}
+
+double RunGenerator(Search& search, Algorithm algorithm, const GridSnapshot& grid, Coordinates start, Coordinates goal,
+                    Consumer& consumer) {
+    const auto begin = Clock::now();
+    for (const auto& event : search.Events(algorithm, grid, start, goal)) {
+        consumer(event);
+    }
+    return std::chrono::duration<double, std::micro>(Clock::now() - begin).count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int reps = 5;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            reps = std::max(1, std::atoi(argv[++i]));
+        }
+    }
+
+    std::printf("%-8s %6s %10s %12s %12s %10s\n", "engine", "size", "events", "loop us", "coro us", "overhead");
+    for (int size : {64, 128, 256}) {
+        OccupancyGrid live = MakeGrid(size, 0.2, 42);
+        const GridSnapshot grid = live.Snapshot();
+        const Coordinates start{0, 0};
+        const Coordinates goal{size - 1, size - 1};
+        for (Algorithm algorithm : {Algorithm::kBfs, Algorithm::kAStar}) {
+            // Dijkstra's sorted frontier makes the big maps take forever without telling anything new
+            std::vector<double> loop_times;
+            std::vector<double> coro_times;
+            Consumer loop_consumer;
+            Consumer coro_consumer;
+            Search search;
+            for (int r = 0; r < reps; ++r) {
+                // Alternate so that both see the same warm-up and frequency scaling
+                loop_times.push_back(RunLoop(search, algorithm, grid, start, goal, loop_consumer));
+                coro_times.push_back(RunGenerator(search, algorithm, grid, start, goal, coro_consumer));
+            }
+            if (loop_consumer.checksum != coro_consumer.checksum) {
+                std::fprintf(stderr, "event streams differ for %s on %d^2\n", AlgorithmName(algorithm), size);
+                return EXIT_FAILURE;
+            }
+            const double loop_us = Median(loop_times);
+            const double coro_us = Median(coro_times);
+            std::printf("%-8s %6d %10llu %12.1f %12.1f %9.1f%%\n", AlgorithmName(algorithm), size,
+                        static_cast<unsigned long long>(loop_consumer.events / reps), loop_us, coro_us,
+                        100.0 * (coro_us - loop_us) / loop_us);
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,165 @@
+// Compares the memory layouts of the grid planes on BFS and A*, on maps from 256^2 up to 16k^2.
+// The occupancy plane is either the chunked OccupancyGrid (16x16 tiles) or a row-major bit plane, the search
+// state either row-major or in 8x8 tiles. All four combinations expand the same nodes in the same order,
+// only the memory traffic differs. Queries stop after a number of expansions so that the big maps stay affordable,
+// far fewer for A* whose frontier is re-sorted on every pop. The result is the median time per expansion.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "grid.hpp"
+#include "map_generators.hpp"
+#include "search.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    int reps = 5;
+    int max_size = 16384;
+    std::size_t max_expansions = std::size_t{1} << 22;        // BFS
+    std::size_t max_astar_expansions = std::size_t{1} << 12;  // A*
+    MapGenerator generator = MapGenerator::kCave;
+};
+
+// Both occupancy planes of one generated map
+struct Map {
+    int size = 0;
+    Coordinates start{}, goal{};
+    std::vector<std::uint64_t> words;  // Backs bits
+    BitGridView bits;
+    GridSnapshot chunks;
+};
+
+Map MakeMap(MapGenerator generator, int size) {
+    Map map;
+    {
+        const GeneratedMap generated = GenerateMap(generator, size, size, 42);
+        map.size = size;
+        map.start = generated.start;
+        map.goal = generated.goal;
+        const std::size_t stride = (static_cast<std::size_t>(size) + 63) / 64;
+        map.words.assign(stride * size, 0);
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                if (generated.IsObstacle(x, y)) {
+                    map.words[y * stride + x / 64] |= std::uint64_t{1} << (x % 64);
+                }
+            }
+        }
+        map.bits = BitGridView(map.words.data(), size, size, stride);
+    }
+    OccupancyGrid grid(size, size);
+    grid.Assign(map.bits);
+    map.chunks = grid.Snapshot();
+    return map;
+}
+
+double Median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+struct Timing {
+    double ns_per_expansion = 0.0;
+    std::size_t expanded = 0;
+};
+
+// A fresh search per combination, so only one set of search planes is alive at a time
+template <typename Grid, typename Layout>
+Timing Measure(const Options& options, Algorithm algorithm, const Grid& grid, Coordinates start, Coordinates goal) {
+    const std::size_t max_expansions =
+        algorithm == Algorithm::kAStar ? options.max_astar_expansions : options.max_expansions;
+    BasicSearch<Grid, Layout> search;
+    std::vector<SearchEvent> events;
+    std::vector<double> times;
+    Timing timing;
+    // One untimed round lays out the search planes
+    for (int r = 0; r <= options.reps; ++r) {
+        const auto begin = Clock::now();
+        search.Begin(algorithm, grid, start, goal);
+        while (!search.IsDone() && search.NodesExpanded() < max_expansions) {
+            events.clear();
+            search.Step(1024, events);
+        }
+        const double ns = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+        timing.expanded = search.NodesExpanded();
+        if (r > 0) {
+            times.push_back(ns / static_cast<double>(std::max<std::size_t>(timing.expanded, 1)));
+        }
+    }
+    timing.ns_per_expansion = Median(times);
+    return timing;
+}
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            options.reps = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--max-size") == 0 && i + 1 < argc) {
+            options.max_size = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--max-expansions") == 0 && i + 1 < argc) {
+            options.max_expansions = static_cast<std::size_t>(std::max(1LL, std::atoll(argv[++i])));
+        } else if (std::strcmp(argv[i], "--max-astar-expansions") == 0 && i + 1 < argc) {
+            options.max_astar_expansions = static_cast<std::size_t>(std::max(1LL, std::atoll(argv[++i])));
+        } else if (std::strcmp(argv[i], "--generate") == 0 && i + 1 < argc) {
+            const std::string name = argv[++i];
+            const auto it = std::find_if(kAllMapGenerators.begin(), kAllMapGenerators.end(),
+                                         [&name](MapGenerator g) { return name == MapGeneratorName(g); });
+            if (it == kAllMapGenerators.end()) {
+                return false;
+            }
+            options.generator = *it;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        std::fprintf(stderr,
+                     "usage: layout_bench [--reps N] [--max-size N] [--max-expansions N] [--max-astar-expansions N]\n"
+                     "                    [--generate random|division|maze|rooms|cave]\n");
+        return EXIT_FAILURE;
+    }
+
+    std::printf("default layout: %s\n", CellLayout::kName);
+    std::printf("%-6s %-8s %-10s %12s %14s %14s %9s\n", "size", "engine", "occupancy", "expanded", "row_major ns",
+                "tiled ns", "change");
+    for (int size : {256, 1024, 4096, 16384}) {
+        if (size > options.max_size) {
+            break;
+        }
+        const Map map = MakeMap(options.generator, size);
+        for (Algorithm algorithm : {Algorithm::kBfs, Algorithm::kAStar}) {
+            const auto report = [&](const char* occupancy, const Timing& row_major, const Timing& tiled) {
+                if (row_major.expanded != tiled.expanded) {
+                    std::fprintf(stderr, "layouts expanded different nodes for %s on %d^2\n", AlgorithmName(algorithm),
+                                 size);
+                    std::exit(EXIT_FAILURE);
+                }
+                std::printf("%-6d %-8s %-10s %12zu %14.2f %14.2f %8.1f%%\n", size, AlgorithmName(algorithm), occupancy,
+                            row_major.expanded, row_major.ns_per_expansion, tiled.ns_per_expansion,
+                            100.0 * (tiled.ns_per_expansion - row_major.ns_per_expansion) / row_major.ns_per_expansion);
+                std::fflush(stdout);
+            };
+            report("chunks", Measure<GridSnapshot, RowMajorLayout>(options, algorithm, map.chunks, map.start, map.goal),
+                   Measure<GridSnapshot, TiledLayout>(options, algorithm, map.chunks, map.start, map.goal));
+            report("bits", Measure<BitGridView, RowMajorLayout>(options, algorithm, map.bits, map.start, map.goal),
+                   Measure<BitGridView, TiledLayout>(options, algorithm, map.bits, map.start, map.goal));
+        }
+    }
+    return EXIT_SUCCESS;
+}
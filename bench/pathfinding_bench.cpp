@@ -0,0 +1,332 @@
+// Runs every query of one or more MovingAI .scen files through each engine and reports
+// throughput, node expansions, suboptimality and latency percentiles per engine.
+//
+// Usage: pathfinding_bench [--map-dir DIR] [--engines bfs,dijkstra,astar] [--limit N] [--mmap] [--perf]
+//                          [--generate KIND --size N --count N --seed N] [FILE.scen...]
+//
+// With --mmap the maps are not parsed but <map>.spgrid files made by grid_convert get mapped
+// and searched in place.
+// --generate adds --count maps of the given kind (random, division, maze, rooms, cave), seeded
+// with --seed, --seed + 1, ..., and searches each one from corner to corner.
+// --perf attaches perf counters to the searches and adds a table of instructions, cache and branch
+// misses, page faults and context switches per query. It adds a few system calls to every query.
+// Built with ENABLE_ALLOC_TRACKING it also reports the allocations per query.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "alloc_tracker.hpp"
+#include "components.hpp"
+#include "grid_file.hpp"
+#include "map_generators.hpp"
+#include "movingai.hpp"
+#include "perf_counters.hpp"
+#include "search.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string map_dir;
+    std::vector<Algorithm> engines{kAllAlgorithms.begin(), kAllAlgorithms.end()};
+    std::size_t limit = 0;  // Queries per .scen file, 0 means all
+    bool mmap = false;
+    bool perf = false;
+    bool components = false;
+    std::vector<std::string> scenario_files;
+    std::vector<MapGenerator> generators;
+    int generate_size = 256;
+    int generate_count = 10;
+    std::uint64_t generate_seed = 1;
+};
+
+struct EngineReport {
+    Algorithm algorithm = Algorithm::kBfs;
+    std::vector<double> latencies_us;
+    std::size_t solved = 0;
+    std::size_t rejected = 0;  // Answered by the component index without searching
+    std::uint64_t nodes_expanded = 0;
+    double suboptimality_sum = 0.0;
+    std::size_t suboptimality_count = 0;
+    PerfCounts perf;
+    AllocCounts allocations;
+};
+
+void PrintUsage() {
+    std::fprintf(stderr, "usage: pathfinding_bench [--map-dir DIR] [--engines bfs,dijkstra,astar] [--limit N] [--mmap] [--perf]\n"
+                 "                         [--components]\n"
+                 "                         [--generate random|division|maze|rooms|cave --size N --count N --seed N] "
+                 "[FILE.scen...]\n");
+}
+
+bool ParseEngines(const std::string& list, std::vector<Algorithm>& engines) {
+    engines.clear();
+    std::size_t begin = 0;
+    while (begin <= list.size()) {
+        const std::size_t end = std::min(list.find(',', begin), list.size());
+        const std::string name = list.substr(begin, end - begin);
+        auto it = std::find_if(kAllAlgorithms.begin(), kAllAlgorithms.end(),
+                               [&name](Algorithm a) { return name == AlgorithmName(a); });
+        if (it == kAllAlgorithms.end()) {
+            std::fprintf(stderr, "unknown engine '%s'\n", name.c_str());
+            return false;
+        }
+        engines.push_back(*it);
+        begin = end + 1;
+    }
+    return true;
+}
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const bool has_value = i + 1 < argc;
+        if (std::strcmp(argv[i], "--map-dir") == 0 && has_value) {
+            options.map_dir = argv[++i];
+        } else if (std::strcmp(argv[i], "--engines") == 0 && has_value) {
+            if (!ParseEngines(argv[++i], options.engines)) {
+                return false;
+            }
+        } else if (std::strcmp(argv[i], "--limit") == 0 && has_value) {
+            options.limit = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--mmap") == 0) {
+            options.mmap = true;
+        } else if (std::strcmp(argv[i], "--perf") == 0) {
+            options.perf = true;
+        } else if (std::strcmp(argv[i], "--components") == 0) {
+            options.components = true;
+        } else if (std::strcmp(argv[i], "--generate") == 0 && has_value) {
+            const std::string name = argv[++i];
+            auto it = std::find_if(kAllMapGenerators.begin(), kAllMapGenerators.end(),
+                                   [&name](MapGenerator g) { return name == MapGeneratorName(g); });
+            if (it == kAllMapGenerators.end()) {
+                std::fprintf(stderr, "unknown generator '%s'\n", name.c_str());
+                return false;
+            }
+            options.generators.push_back(*it);
+        } else if (std::strcmp(argv[i], "--size") == 0 && has_value) {
+            options.generate_size = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--count") == 0 && has_value) {
+            options.generate_count = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--seed") == 0 && has_value) {
+            options.generate_seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (argv[i][0] == '-') {
+            return false;
+        } else {
+            options.scenario_files.emplace_back(argv[i]);
+        }
+    }
+    return !options.scenario_files.empty() || !options.generators.empty();
+}
+
+std::string ResolveMapPath(const Options& options, const std::string& scenario_file, const std::string& map) {
+    namespace fs = std::filesystem;
+    if (!options.map_dir.empty()) {
+        return (fs::path(options.map_dir) / fs::path(map).filename()).string();
+    }
+    const fs::path beside_scenario = fs::path(scenario_file).parent_path() / map;
+    if (fs::exists(beside_scenario)) {
+        return beside_scenario.string();
+    }
+    // Scenario files often name the map relative to the benchmark root instead
+    return (fs::path(scenario_file).parent_path() / fs::path(map).filename()).string();
+}
+
+double Percentile(std::vector<double> values, double p) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    const auto rank = static_cast<std::size_t>(p * static_cast<double>(values.size() - 1) + 0.5);
+    return values[rank];
+}
+
+// With --components every map is labelled once, the time goes to the summary instead of the queries
+struct ComponentReport {
+    std::size_t maps = 0;
+    double build_ms = 0.0;
+};
+
+template <typename Grid>
+ComponentIndex* LabelMap(const Options& options, std::map<std::string, ComponentIndex>& indices, const std::string& key,
+                         const Grid& grid, ComponentReport& report) {
+    if (!options.components) {
+        return nullptr;
+    }
+    auto it = indices.find(key);
+    if (it == indices.end()) {
+        const auto begin = Clock::now();
+        it = indices.emplace(key, ComponentIndex()).first;
+        it->second.Build(grid);
+        report.build_ms += std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+        ++report.maps;
+    }
+    return &it->second;
+}
+
+// components may be nullptr, otherwise queries across components are rejected before searching
+template <typename Grid>
+void RunScenario(BasicSearch<Grid>& search, const Grid& grid, const MovingAiScenario& scenario, ComponentIndex* components,
+                 std::vector<EngineReport>& reports, std::vector<SearchEvent>& events) {
+    for (auto& report : reports) {
+        events.clear();
+        const auto begin = Clock::now();
+        if (components != nullptr && !components->IsConnected(scenario.start, scenario.goal)) {
+            report.latencies_us.push_back(std::chrono::duration<double, std::micro>(Clock::now() - begin).count());
+            ++report.rejected;
+            continue;
+        }
+        search.Begin(report.algorithm, grid, scenario.start, scenario.goal);
+        search.Run(events);
+        report.latencies_us.push_back(std::chrono::duration<double, std::micro>(Clock::now() - begin).count());
+        report.nodes_expanded += search.NodesExpanded();
+        report.perf += search.Stats().perf;
+        report.allocations += search.Stats().allocations;
+        if (search.IsPathFound()) {
+            ++report.solved;
+            if (scenario.optimal_length > 0.0) {
+                report.suboptimality_sum += static_cast<double>(search.PathLength()) / scenario.optimal_length;
+                ++report.suboptimality_count;
+            }
+        }
+    }
+}
+
+void CheckSize(int width, int height, const MovingAiScenario& scenario, const std::string& map_path) {
+    if (width != scenario.map_width || height != scenario.map_height) {
+        throw std::runtime_error(map_path + ": size doesn't match the scenario");
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+
+    std::vector<EngineReport> reports;
+    for (Algorithm algorithm : options.engines) {
+        EngineReport report;
+        report.algorithm = algorithm;
+        reports.push_back(std::move(report));
+    }
+
+    std::map<std::string, GridSnapshot> maps;
+    std::map<std::string, std::unique_ptr<MappedGrid>> mapped_maps;
+    std::map<std::string, ComponentIndex> component_indices;
+    ComponentReport component_report;
+    Search search;
+    BasicSearch<BitGridView> mapped_search;
+    PerfCounters perf_counters;
+    if (options.perf) {
+        search.SetPerfCounters(&perf_counters);
+        mapped_search.SetPerfCounters(&perf_counters);
+    }
+    std::vector<SearchEvent> events;
+    try {
+        for (const auto& scenario_file : options.scenario_files) {
+            auto scenarios = LoadMovingAiScenarios(scenario_file);
+            if (options.limit != 0 && scenarios.size() > options.limit) {
+                scenarios.resize(options.limit);
+            }
+            for (const auto& scenario : scenarios) {
+                const std::string map_path = ResolveMapPath(options, scenario_file, scenario.map);
+                if (options.mmap) {
+                    const std::string file_path = map_path + ".spgrid";
+                    auto it = mapped_maps.find(file_path);
+                    if (it == mapped_maps.end()) {
+                        it = mapped_maps.emplace(file_path, std::make_unique<MappedGrid>(file_path)).first;
+                    }
+                    CheckSize(it->second->Width(), it->second->Height(), scenario, file_path);
+                    ComponentIndex* components =
+                        LabelMap(options, component_indices, file_path, it->second->View(), component_report);
+                    RunScenario(mapped_search, it->second->View(), scenario, components, reports, events);
+                } else {
+                    auto it = maps.find(map_path);
+                    if (it == maps.end()) {
+                        OccupancyGrid grid = LoadMovingAiMap(map_path);
+                        it = maps.emplace(map_path, grid.Snapshot()).first;
+                    }
+                    CheckSize(it->second.Width(), it->second.Height(), scenario, map_path);
+                    ComponentIndex* components = LabelMap(options, component_indices, map_path, it->second, component_report);
+                    RunScenario(search, it->second, scenario, components, reports, events);
+                }
+            }
+        }
+        for (MapGenerator generator : options.generators) {
+            for (int i = 0; i < options.generate_count; ++i) {
+                const std::uint64_t seed = options.generate_seed + static_cast<std::uint64_t>(i);
+                const GeneratedMap map = GenerateMap(generator, options.generate_size, options.generate_size, seed);
+                OccupancyGrid grid = map.ToOccupancyGrid();
+                const MovingAiScenario query{0, MapGeneratorName(generator), map.width, map.height, map.start, map.goal, 0.0};
+                const GridSnapshot snapshot = grid.Snapshot();
+                const std::string key = std::string(MapGeneratorName(generator)) + "/" + std::to_string(seed);
+                ComponentIndex* components = LabelMap(options, component_indices, key, snapshot, component_report);
+                RunScenario(search, snapshot, query, components, reports, events);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "error: %s\n", e.what());
+        return EXIT_FAILURE;
+    }
+
+    // Suboptimality compares our 4-connected paths against the 8-connected octile optimum of the
+    // scenario files, so it starts above 1.0 by construction and is mostly useful across engines.
+    std::printf("%-9s %8s %8s %12s %14s %10s %12s %12s\n", "engine", "queries", "solved", "paths/s", "expanded/query",
+                "subopt", "p50 us", "p99 us");
+    for (const auto& report : reports) {
+        const std::size_t queries = report.latencies_us.size();
+        double total_us = 0.0;
+        for (double us : report.latencies_us) {
+            total_us += us;
+        }
+        std::printf("%-9s %8zu %8zu %12.1f %14.1f %10.4f %12.1f %12.1f\n", AlgorithmName(report.algorithm), queries,
+                    report.solved, total_us > 0.0 ? 1e6 * static_cast<double>(queries) / total_us : 0.0,
+                    queries ? static_cast<double>(report.nodes_expanded) / static_cast<double>(queries) : 0.0,
+                    report.suboptimality_count ? report.suboptimality_sum / static_cast<double>(report.suboptimality_count)
+                                               : 0.0,
+                    Percentile(report.latencies_us, 0.50), Percentile(report.latencies_us, 0.99));
+    }
+    if (options.components && !reports.empty()) {
+        std::printf("\ncomponents: %zu maps labelled in %.1f ms, %zu queries per engine rejected without searching\n",
+                    component_report.maps, component_report.build_ms, reports.front().rejected);
+    }
+    if (kAllocTrackingEnabled) {
+        std::printf("\n%-9s %14s %14s\n", "engine", "allocs/query", "bytes/query");
+        for (const auto& report : reports) {
+            const double queries = static_cast<double>(std::max<std::size_t>(report.latencies_us.size(), 1));
+            std::printf("%-9s %14.1f %14.1f\n", AlgorithmName(report.algorithm),
+                        static_cast<double>(report.allocations.allocations) / queries,
+                        static_cast<double>(report.allocations.bytes) / queries);
+        }
+    }
+    if (options.perf) {
+        std::printf("\nperf counters per query, source: %s\n", PerfSourceName(perf_counters.Source()));
+        std::printf("%-9s %14s %6s %12s %12s %10s %10s %12s\n", "engine", "instructions", "IPC", "llc-misses",
+                    "br-misses", "faults", "ctx-sw", "task-clk us");
+        for (const auto& report : reports) {
+            const PerfCounts& perf = report.perf;
+            const double queries = static_cast<double>(std::max<std::size_t>(report.latencies_us.size(), 1));
+            std::printf("%-9s %14.0f %6.2f %12.0f %12.0f %10.2f %10.2f %12.1f\n", AlgorithmName(report.algorithm),
+                        static_cast<double>(perf.instructions) / queries,
+                        perf.cycles ? static_cast<double>(perf.instructions) / static_cast<double>(perf.cycles) : 0.0,
+                        static_cast<double>(perf.cache_misses) / queries, static_cast<double>(perf.branch_misses) / queries,
+                        static_cast<double>(perf.page_faults) / queries, static_cast<double>(perf.context_switches) / queries,
+                        static_cast<double>(perf.task_clock_ns) / 1000.0 / queries);
+        }
+    }
+    return EXIT_SUCCESS;
+}
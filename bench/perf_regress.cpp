@@ -0,0 +1,463 @@
+// Runs a fixed workload through every engine and compares the result with a stored baseline.
+//
+// Usage: perf_regress [--baseline FILE] [--write-baseline FILE] [--output FILE] [--tolerance F]
+//                     [--time-tolerance F] [--reps N] [--perf] [--scen FILE.scen]...
+//
+// The workload is the three editor presets, two seeds of every map generator at 128x128, and the
+// first queries of any scenario files given. For every workload and engine it records the paths
+// solved per second (best of --reps runs), the nodes expanded, and the peak heap held by one search,
+// measured with glibc's allocator statistics. The results are written as tab-separated lines:
+//
+//     <workload> <engine> <queries> <paths/s> <paths per reference> <expanded> <peak heap bytes>
+//
+// Throughput is compared in paths per run of a fixed reference loop timed next to each measurement,
+// which cancels out most of the speed drift of shared machines.
+//
+// With --baseline, an expansion or peak heap increase of more than --tolerance (a fraction, 0.15 by
+// default) or a throughput drop of more than --time-tolerance (0.3 by default, timings stay noisy)
+// against the baseline is a regression and the exit code is 1. Workloads missing from the baseline
+// are reported but don't fail. --baseline and --write-baseline refuse to run in builds without NDEBUG,
+// unoptimized timings say nothing about the stored ones.
+//
+// --perf runs every workload once more with perf counters attached (see include/perf_counters.hpp) and
+// prints instructions, cache and branch misses, page faults and context switches per query. They are
+// for tuning and not part of the baseline. Neither are the allocations per query that a build with
+// ENABLE_ALLOC_TRACKING prints, counted on a Search that is reused from query to query.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef __GLIBC__  // Defined by the C library headers above
+#include <malloc.h>
+#endif
+
+#include "alloc_tracker.hpp"
+#include "grid.hpp"
+#include "map_generators.hpp"
+#include "movingai.hpp"
+#include "perf_counters.hpp"
+#include "presets.hpp"
+#include "search.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Results are folded in here so the compiler can't drop the reference loop
+volatile std::uint64_t g_sink = 0;
+
+constexpr int kGeneratedSize = 128;
+constexpr int kGeneratedSeeds = 2;
+constexpr std::size_t kScenarioQueries = 50;  // Per .scen file
+
+struct Options {
+    std::string baseline;
+    std::string write_baseline;
+    std::string output;
+    double tolerance = 0.15;
+    double time_tolerance = 0.3;
+    int reps = 9;
+    bool perf = false;
+    std::vector<std::string> scenario_files;
+};
+
+struct Query {
+    GridSnapshot grid;
+    Coordinates start, goal;
+};
+
+struct Workload {
+    std::string name;
+    std::vector<Query> queries;
+};
+
+struct Record {
+    std::size_t queries = 0;
+    double paths_per_second = 0.0;     // For people, depends on the machine
+    double paths_per_reference = 0.0;  // Paths per ReferenceMicros(), what gets compared
+    std::uint64_t expanded = 0;
+    std::uint64_t peak_heap = 0;
+    PerfCounts perf;           // Whole workload, only with --perf
+    AllocCounts allocations;  // Whole workload with a reused Search, only with ENABLE_ALLOC_TRACKING
+};
+
+using Results = std::map<std::string, Record>;  // Keyed by "<workload>\t<engine>"
+
+void PrintUsage() {
+    std::fprintf(stderr, "usage: perf_regress [--baseline FILE] [--write-baseline FILE] [--output FILE] [--tolerance F] "
+                 "[--time-tolerance F] [--reps N] [--perf] [--scen FILE.scen]...\n");
+}
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const bool has_value = i + 1 < argc;
+        if (std::strcmp(argv[i], "--baseline") == 0 && has_value) {
+            options.baseline = argv[++i];
+        } else if (std::strcmp(argv[i], "--write-baseline") == 0 && has_value) {
+            options.write_baseline = argv[++i];
+        } else if (std::strcmp(argv[i], "--output") == 0 && has_value) {
+            options.output = argv[++i];
+        } else if (std::strcmp(argv[i], "--tolerance") == 0 && has_value) {
+            options.tolerance = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--time-tolerance") == 0 && has_value) {
+            options.time_tolerance = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--reps") == 0 && has_value) {
+            options.reps = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--perf") == 0) {
+            options.perf = true;
+        } else if (std::strcmp(argv[i], "--scen") == 0 && has_value) {
+            options.scenario_files.emplace_back(argv[++i]);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<Workload> BuildWorkloads(const Options& options) {
+    std::vector<Workload> workloads;
+    Workload presets{"presets", {}};
+    for (const PresetMap& preset : kPresets) {
+        OccupancyGrid grid(kMaxTilesX, kMaxTilesY);
+        grid.Assign(preset.View());
+        presets.queries.push_back(Query{grid.Snapshot(), preset.start, preset.goal});
+    }
+    workloads.push_back(std::move(presets));
+
+    for (MapGenerator generator : kAllMapGenerators) {
+        Workload workload{std::string("gen_") + MapGeneratorName(generator), {}};
+        for (int seed = 1; seed <= kGeneratedSeeds; ++seed) {
+            const GeneratedMap map = GenerateMap(generator, kGeneratedSize, kGeneratedSize, seed);
+            OccupancyGrid grid = map.ToOccupancyGrid();
+            workload.queries.push_back(Query{grid.Snapshot(), map.start, map.goal});
+        }
+        workloads.push_back(std::move(workload));
+    }
+
+    for (const auto& scenario_file : options.scenario_files) {
+        namespace fs = std::filesystem;
+        Workload workload{"scen_" + fs::path(scenario_file).stem().string(), {}};
+        std::map<std::string, GridSnapshot> maps;
+        auto scenarios = LoadMovingAiScenarios(scenario_file);
+        scenarios.resize(std::min(scenarios.size(), kScenarioQueries));
+        for (const auto& scenario : scenarios) {
+            const std::string map_path = (fs::path(scenario_file).parent_path() / fs::path(scenario.map).filename()).string();
+            auto it = maps.find(map_path);
+            if (it == maps.end()) {
+                OccupancyGrid grid = LoadMovingAiMap(map_path);
+                it = maps.emplace(map_path, grid.Snapshot()).first;
+            }
+            workload.queries.push_back(Query{it->second, scenario.start, scenario.goal});
+        }
+        workloads.push_back(std::move(workload));
+    }
+    return workloads;
+}
+
+// Heap bytes in use, 0 where the allocator can't tell
+std::uint64_t HeapInUse() {
+#ifdef __GLIBC__
+    return mallinfo2().uordblks;
+#else
+    return 0;
+#endif
+}
+
+// A fresh search per query, so every query pays for its own tables like the first job of the GUI worker does
+std::uint64_t PeakHeap(const Workload& workload, Algorithm algorithm) {
+    std::uint64_t peak = 0;
+    for (const auto& query : workload.queries) {
+        const std::uint64_t before = HeapInUse();
+        {
+            Search search;
+            std::vector<SearchEvent> events;
+            search.Begin(algorithm, query.grid, query.start, query.goal);
+            search.Run(events);
+            // The tables only grow during a search, so the end is the high-water mark
+            const std::uint64_t after = HeapInUse();
+            peak = std::max(peak, after > before ? after - before : 0);
+        }
+    }
+    return peak;
+}
+
+// Separate from the timed runs, reading the counters costs a few system calls per query
+PerfCounts CountPerf(const Workload& workload, Algorithm algorithm, PerfCounters& counters) {
+    PerfCounts total;
+    Search search;
+    search.SetPerfCounters(&counters);
+    std::vector<SearchEvent> events;
+    for (const auto& query : workload.queries) {
+        events.clear();
+        search.Begin(algorithm, query.grid, query.start, query.goal);
+        total += search.Run(events).perf;
+    }
+    return total;
+}
+
+// Time of a fixed loop with the same kind of work as a search that doesn't call any of our code: Dijkstra over a
+// 64x64 grid of weights, reading and writing flat per-cell arrays and pushing and popping a binary heap.
+// Shared hosts drift in speed by tens of percent between and within runs, so throughput is stored relative to
+// this reference, timed right next to every measurement.
+double ReferenceMicros() {
+    constexpr int kSide = 64;
+    constexpr std::uint32_t kCells = kSide * kSide;
+    const auto begin = Clock::now();
+    std::vector<std::uint32_t> weights(kCells);
+    std::vector<std::uint32_t> costs(kCells, ~std::uint32_t{0});
+    for (std::uint32_t i = 0; i < kCells; ++i) {
+        weights[i] = 1 + (i * 7919) % 13;
+    }
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> heap;  // Cost and cell, cheapest first
+    heap.reserve(4 * kCells);
+    const auto cheapest = std::greater<>();
+    costs[0] = 0;
+    heap.emplace_back(0, 0);
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), cheapest);
+        const auto [cost, cell] = heap.back();
+        heap.pop_back();
+        if (cost > costs[cell]) {
+            continue;
+        }
+        const std::uint32_t x = cell % kSide;
+        const std::uint32_t y = cell / kSide;
+        const std::uint32_t neighbors[4] = {x > 0 ? cell - 1 : cell, x + 1 < kSide ? cell + 1 : cell,
+                                            y > 0 ? cell - kSide : cell, y + 1 < kSide ? cell + kSide : cell};
+        for (std::uint32_t next : neighbors) {
+            const std::uint32_t next_cost = cost + weights[next];
+            if (next_cost < costs[next]) {
+                costs[next] = next_cost;
+                heap.emplace_back(next_cost, next);
+                std::push_heap(heap.begin(), heap.end(), cheapest);
+            }
+        }
+    }
+    std::uint64_t sum = 0;
+    for (std::uint32_t cost : costs) {
+        sum += cost;
+    }
+    g_sink = g_sink + sum;
+    return std::chrono::duration<double, std::micro>(Clock::now() - begin).count();
+}
+
+Results Run(const std::vector<Workload>& workloads, int reps, bool perf) {
+    Results results;
+    PerfCounters counters;
+    Search search;
+    std::vector<SearchEvent> events;
+    for (const auto& workload : workloads) {
+        for (Algorithm algorithm : kAllAlgorithms) {
+            Record record;
+            record.queries = workload.queries.size();
+            record.peak_heap = PeakHeap(workload, algorithm);
+            double best_us = 0.0;
+            double best_reference_us = 0.0;
+            for (int r = 0; r < reps; ++r) {
+                std::uint64_t expanded = 0;
+                AllocCounts allocations;
+                const double reference_us = ReferenceMicros();
+                const auto begin = Clock::now();
+                for (const auto& query : workload.queries) {
+                    events.clear();
+                    search.Begin(algorithm, query.grid, query.start, query.goal);
+                    search.Run(events);
+                    expanded += search.NodesExpanded();
+                    allocations += search.Stats().allocations;
+                }
+                const double us = std::chrono::duration<double, std::micro>(Clock::now() - begin).count();
+                best_us = r == 0 ? us : std::min(best_us, us);
+                best_reference_us = r == 0 ? reference_us : std::min(best_reference_us, reference_us);
+                record.expanded = expanded;
+                record.allocations = allocations;
+            }
+            record.paths_per_second = 1e6 * static_cast<double>(record.queries) / best_us;
+            record.paths_per_reference = static_cast<double>(record.queries) * best_reference_us / best_us;
+            if (perf) {
+                record.perf = CountPerf(workload, algorithm, counters);
+            }
+            results[workload.name + "\t" + AlgorithmName(algorithm)] = record;
+        }
+    }
+    return results;
+}
+
+void WriteResults(const Results& results, std::FILE* out) {
+    for (const auto& [key, record] : results) {
+        std::fprintf(out, "%s\t%zu\t%.2f\t%.4f\t%llu\t%llu\n", key.c_str(), record.queries, record.paths_per_second,
+                     record.paths_per_reference, static_cast<unsigned long long>(record.expanded),
+                     static_cast<unsigned long long>(record.peak_heap));
+    }
+}
+
+bool WriteResults(const Results& results, const std::string& path) {
+    std::FILE* out = std::fopen(path.c_str(), "w");
+    if (out == nullptr) {
+        std::fprintf(stderr, "error: can't write %s\n", path.c_str());
+        return false;
+    }
+    WriteResults(results, out);
+    std::fclose(out);
+    return true;
+}
+
+Results ReadResults(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("can't read " + path);
+    }
+    Results results;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream fields(line);
+        std::string workload, engine;
+        Record record;
+        if (!(fields >> workload >> engine >> record.queries >> record.paths_per_second >> record.paths_per_reference >>
+              record.expanded >> record.peak_heap)) {
+            throw std::runtime_error(path + ": malformed line '" + line + "'");
+        }
+        results[workload + "\t" + engine] = record;
+    }
+    return results;
+}
+
+void PrintPerf(const Results& results) {
+    std::printf("%-16s %-9s %9s %12s %6s %12s %12s %8s %8s %12s\n", "workload", "engine", "source", "instr/query", "IPC",
+                "llc-miss/q", "br-miss/q", "faults", "ctx-sw", "cpu us/q");
+    for (const auto& [key, record] : results) {
+        const std::string workload = key.substr(0, key.find('\t'));
+        const std::string engine = key.substr(key.find('\t') + 1);
+        const PerfCounts& perf = record.perf;
+        const double queries = static_cast<double>(std::max<std::size_t>(record.queries, 1));
+        std::printf("%-16s %-9s %9s %12.0f %6.2f %12.0f %12.0f %8llu %8llu %12.1f\n", workload.c_str(), engine.c_str(),
+                    PerfSourceName(perf.source), static_cast<double>(perf.instructions) / queries,
+                    perf.cycles ? static_cast<double>(perf.instructions) / static_cast<double>(perf.cycles) : 0.0,
+                    static_cast<double>(perf.cache_misses) / queries, static_cast<double>(perf.branch_misses) / queries,
+                    static_cast<unsigned long long>(perf.page_faults), static_cast<unsigned long long>(perf.context_switches),
+                    static_cast<double>(perf.task_clock_ns) / 1000.0 / queries);
+    }
+}
+
+void PrintAllocations(const Results& results) {
+    std::printf("%-16s %-9s %14s %14s\n", "workload", "engine", "allocs/query", "bytes/query");
+    for (const auto& [key, record] : results) {
+        const std::string workload = key.substr(0, key.find('\t'));
+        const std::string engine = key.substr(key.find('\t') + 1);
+        const double queries = static_cast<double>(std::max<std::size_t>(record.queries, 1));
+        std::printf("%-16s %-9s %14.1f %14.1f\n", workload.c_str(), engine.c_str(),
+                    static_cast<double>(record.allocations.allocations) / queries,
+                    static_cast<double>(record.allocations.bytes) / queries);
+    }
+}
+
+// Figures that are reported but never compared, after the results so that those stay easy to parse
+void PrintExtras(const Results& results, const Options& options) {
+    if (options.perf) {
+        std::printf("\n");
+        PrintPerf(results);
+    }
+    if (kAllocTrackingEnabled) {
+        std::printf("\n");
+        PrintAllocations(results);
+    }
+}
+
+// Relative change from the baseline, positive means more
+double Change(double baseline, double current) {
+    return baseline > 0.0 ? (current - baseline) / baseline : 0.0;
+}
+
+int Compare(const Results& baseline, const Results& current, double tolerance, double time_tolerance) {
+    int regressions = 0;
+    std::printf("%-16s %-9s %12s %8s %10s %8s %10s %8s\n", "workload", "engine", "paths/s", "change", "expanded", "change",
+                "heap KiB", "change");
+    for (const auto& [key, record] : current) {
+        const std::string workload = key.substr(0, key.find('\t'));
+        const std::string engine = key.substr(key.find('\t') + 1);
+        std::printf("%-16s %-9s %12.1f", workload.c_str(), engine.c_str(), record.paths_per_second);
+        auto it = baseline.find(key);
+        if (it == baseline.end()) {
+            std::printf(" %8s %10llu %8s %10.1f %8s  new\n", "-", static_cast<unsigned long long>(record.expanded), "-",
+                        static_cast<double>(record.peak_heap) / 1024.0, "-");
+            continue;
+        }
+        const Record& base = it->second;
+        const double throughput = Change(base.paths_per_reference, record.paths_per_reference);
+        const double expansions = Change(static_cast<double>(base.expanded), static_cast<double>(record.expanded));
+        const double heap = Change(static_cast<double>(base.peak_heap), static_cast<double>(record.peak_heap));
+        const bool regressed = throughput < -time_tolerance || expansions > tolerance || heap > tolerance;
+        regressions += regressed;
+        std::printf(" %+7.1f%% %10llu %+7.1f%% %10.1f %+7.1f%%%s\n", 100.0 * throughput,
+                    static_cast<unsigned long long>(record.expanded), 100.0 * expansions,
+                    static_cast<double>(record.peak_heap) / 1024.0, 100.0 * heap, regressed ? "  REGRESSION" : "");
+    }
+    return regressions;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage();
+        return 2;
+    }
+
+#ifndef NDEBUG
+    // The baseline holds timings of an optimized build, an unoptimized one would regress on every engine
+    if (!options.baseline.empty() || !options.write_baseline.empty()) {
+        std::fprintf(stderr, "error: baselines need an optimized build, configure with -DCMAKE_BUILD_TYPE=Release\n");
+        return 2;
+    }
+#endif
+
+    Results current;
+    Results baseline;
+    try {
+        if (!options.baseline.empty()) {
+            baseline = ReadResults(options.baseline);
+        }
+        current = Run(BuildWorkloads(options), options.reps, options.perf);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "error: %s\n", e.what());
+        return 2;
+    }
+
+    if (!options.output.empty() && !WriteResults(current, options.output)) {
+        return 2;
+    }
+    if (!options.write_baseline.empty() && !WriteResults(current, options.write_baseline)) {
+        return 2;
+    }
+    if (options.baseline.empty()) {
+        if (options.output.empty() && options.write_baseline.empty()) {
+            WriteResults(current, stdout);
+        }
+        PrintExtras(current, options);
+        return EXIT_SUCCESS;
+    }
+
+    const int regressions = Compare(baseline, current, options.tolerance, options.time_tolerance);
+    std::printf("%d regression(s), tolerance %.0f%% for work and memory, %.0f%% for throughput\n", regressions,
+                100.0 * options.tolerance, 100.0 * options.time_tolerance);
+    PrintExtras(current, options);
+    if (regressions > 0) {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,266 @@
+// Times the Search primitives one at a time on random maps of several sizes, so a speedup of a whole
+// search can be traced back to the hot-path function that caused it.
+//
+// Usage: search_microbench [--reps N] [--json]
+//
+// Every benchmark runs a batch of operations per repetition and reports the median and the median
+// absolute deviation (MAD) of the time per operation over all repetitions. Built with
+// ENABLE_ALLOC_TRACKING it also reports the heap allocations per operation.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "alloc_tracker.hpp"
+#include "grid.hpp"
+#include "map_generators.hpp"
+#include "search.hpp"
+
+// Befriended by BasicSearch to reach the private primitives
+struct SearchProbe {
+    static bool InBounds(const Search& search, Coordinates at) {
+        return search.InBounds(at);
+    }
+    static bool Passable(const Search& search, Coordinates at) {
+        return search.Passable(at);
+    }
+    static std::size_t Neighbors(const Search& search, Coordinates at) {
+        return search.Neighbors(at).size();
+    }
+    static double Cost(const Search& search, Coordinates from, Coordinates to) {
+        return search.Cost(from, to);
+    }
+    static double Heuristic(Search& search, Coordinates a, Coordinates b) {
+        return search.Heuristic(a, b);
+    }
+    static void ClearFrontier(Search& search) {
+        search.workspace_.Frontier().clear();
+    }
+    static void PushFrontier(Search& search, Coordinates at, double priority) {
+        search.PushFrontier(at, priority);
+    }
+    static std::pair<Coordinates, double> PopFrontier(Search& search) {
+        return search.PopFrontier();
+    }
+    static void SetPath(Search& search) {
+        search.SetPath();
+    }
+};
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Results are folded in here so the compiler can't drop the timed calls
+volatile std::uint64_t g_sink = 0;
+
+struct Result {
+    std::string name;
+    int size;
+    std::size_t ops_per_rep;
+    double median_ns;
+    double mad_ns;
+    double allocs_per_op = 0.0;  // Only counted with ENABLE_ALLOC_TRACKING
+};
+
+double Median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    const std::size_t mid = values.size() / 2;
+    return values.size() % 2 ? values[mid] : 0.5 * (values[mid - 1] + values[mid]);
+}
+
+Result Summarize(const std::string& name, int size, std::size_t ops, const std::vector<double>& per_op) {
+    const double median = Median(per_op);
+    std::vector<double> deviations;
+    for (double value : per_op) {
+        deviations.push_back(std::abs(value - median));
+    }
+    return Result{name, size, ops, median, Median(deviations)};
+}
+
+// batch runs one repetition and returns how many operations it did
+Result Measure(const std::string& name, int size, int reps, const std::function<std::size_t()>& batch) {
+    std::size_t ops = batch();  // Warm-up
+    std::vector<double> per_op;
+    std::uint64_t allocations = 0, total_ops = 0;
+    for (int r = 0; r < reps; ++r) {
+        const AllocCounts before = ThreadAllocCounts();
+        const auto begin = Clock::now();
+        ops = batch();
+        const double ns = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+        allocations += (ThreadAllocCounts() - before).allocations;
+        total_ops += ops;
+        per_op.push_back(ns / static_cast<double>(std::max<std::size_t>(ops, 1)));
+    }
+    Result result = Summarize(name, size, ops, per_op);
+    result.allocs_per_op = static_cast<double>(allocations) / static_cast<double>(std::max<std::uint64_t>(total_ops, 1));
+    return result;
+}
+
+void RunSize(int size, int reps, std::vector<Result>& results) {
+    const GeneratedMap map = GenerateMap(MapGenerator::kRandomFill, size, size, 1);
+    OccupancyGrid live = map.ToOccupancyGrid();
+    const GridSnapshot grid = live.Snapshot();
+
+    // A finished BFS gives SetPath() a realistic came_from_ table, the other primitives only need the grid
+    Search search;
+    std::vector<SearchEvent> events;
+    search.Begin(Algorithm::kBfs, grid, map.start, map.goal);
+    search.Run(events);
+
+    results.push_back(Measure("in_bounds", size, reps, [&] {
+        std::uint64_t hits = 0;
+        for (int y = -1; y <= size; ++y) {
+            for (int x = -1; x <= size; ++x) {
+                hits += SearchProbe::InBounds(search, Coordinates{x, y});
+            }
+        }
+        g_sink = g_sink + hits;
+        return static_cast<std::size_t>(size + 2) * (size + 2);
+    }));
+    results.push_back(Measure("passable", size, reps, [&] {
+        std::uint64_t hits = 0;
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                hits += SearchProbe::Passable(search, Coordinates{x, y});
+            }
+        }
+        g_sink = g_sink + hits;
+        return static_cast<std::size_t>(size) * size;
+    }));
+    results.push_back(Measure("neighbors", size, reps, [&] {
+        std::uint64_t count = 0;
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                count += SearchProbe::Neighbors(search, Coordinates{x, y});
+            }
+        }
+        g_sink = g_sink + count;
+        return static_cast<std::size_t>(size) * size;
+    }));
+    results.push_back(Measure("cost", size, reps, [&] {
+        double sum = 0.0;
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x + 1 < size; ++x) {
+                sum += SearchProbe::Cost(search, Coordinates{x, y}, Coordinates{x + 1, y});
+            }
+        }
+        g_sink = g_sink + static_cast<std::uint64_t>(sum);
+        return static_cast<std::size_t>(size - 1) * size;
+    }));
+    results.push_back(Measure("heuristic", size, reps, [&] {
+        double sum = 0.0;
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                sum += SearchProbe::Heuristic(search, Coordinates{x, y}, map.goal);
+            }
+        }
+        g_sink = g_sink + static_cast<std::uint64_t>(sum);
+        return static_cast<std::size_t>(size) * size;
+    }));
+
+    // The frontier holds about one row of the map at a time during a search, so size entries it is
+    std::vector<double> priorities(size);
+    for (int i = 0; i < size; ++i) {
+        priorities[i] = static_cast<double>((i * 7919) % size) + 0.001 * (i % 3);
+    }
+    results.push_back(Measure("frontier_push", size, reps, [&] {
+        SearchProbe::ClearFrontier(search);
+        for (int i = 0; i < size; ++i) {
+            SearchProbe::PushFrontier(search, Coordinates{i, 0}, priorities[i]);
+        }
+        return static_cast<std::size_t>(size);
+    }));
+    // Times pops only, refilling between repetitions happens outside of the clock
+    std::vector<double> pop_times;
+    std::uint64_t pop_allocations = 0;
+    for (int r = 0; r <= reps; ++r) {
+        SearchProbe::ClearFrontier(search);
+        for (int i = 0; i < size; ++i) {
+            SearchProbe::PushFrontier(search, Coordinates{i, 0}, priorities[i]);
+        }
+        std::uint64_t sum = 0;
+        const AllocCounts before = ThreadAllocCounts();
+        const auto begin = Clock::now();
+        for (int i = 0; i < size; ++i) {
+            sum += SearchProbe::PopFrontier(search).first.x;
+        }
+        const double ns = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+        pop_allocations += (ThreadAllocCounts() - before).allocations;
+        g_sink = g_sink + sum;
+        if (r > 0) {  // The first round is the warm-up
+            pop_times.push_back(ns / size);
+        }
+    }
+    results.push_back(Summarize("frontier_pop", size, static_cast<std::size_t>(size), pop_times));
+    results.back().allocs_per_op = static_cast<double>(pop_allocations) / (static_cast<double>(reps + 1) * size);
+
+    if (search.IsPathFound()) {
+        results.push_back(Measure("set_path", size, reps, [&] {
+            SearchProbe::SetPath(search);
+            return search.PathLength();
+        }));
+    }
+}
+
+void PrintTable(const std::vector<Result>& results) {
+    std::printf("%-14s %6s %12s %14s %12s %10s\n", "primitive", "size", "ops/rep", "median ns/op", "MAD ns/op",
+                "allocs/op");
+    for (const auto& result : results) {
+        std::printf("%-14s %6d %12zu %14.2f %12.2f", result.name.c_str(), result.size, result.ops_per_rep,
+                    result.median_ns, result.mad_ns);
+        if (kAllocTrackingEnabled) {
+            std::printf(" %10.3f\n", result.allocs_per_op);
+        } else {
+            std::printf(" %10s\n", "-");
+        }
+    }
+}
+
+void PrintJson(const std::vector<Result>& results, int reps) {
+    std::printf("{\n  \"reps\": %d,\n  \"benchmarks\": [\n", reps);
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const auto& result = results[i];
+        std::printf("    {\"name\": \"%s\", \"size\": %d, \"ops_per_rep\": %zu, \"median_ns\": %.3f, \"mad_ns\": %.3f",
+                    result.name.c_str(), result.size, result.ops_per_rep, result.median_ns, result.mad_ns);
+        if (kAllocTrackingEnabled) {
+            std::printf(", \"allocs_per_op\": %.3f", result.allocs_per_op);
+        }
+        std::printf("}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    std::printf("  ]\n}\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int reps = 15;
+    bool json = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            reps = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else {
+            std::fprintf(stderr, "usage: search_microbench [--reps N] [--json]\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::vector<Result> results;
+    for (int size : {64, 256, 1024}) {
+        RunSize(size, reps, results);
+    }
+    if (json) {
+        PrintJson(results, reps);
+    } else {
+        PrintTable(results);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+// Opt-in allocation accounting. Configuring with ENABLE_ALLOC_TRACKING=ON replaces the global operator
+// new, which then counts every allocation of the calling thread. Without it the counts stay zero.
+
+#ifdef PATHFINDING_ALLOC_TRACKING
+constexpr bool kAllocTrackingEnabled = true;
+#else
+constexpr bool kAllocTrackingEnabled = false;
+#endif
+
+struct AllocCounts {
+    std::uint64_t allocations = 0;
+    std::uint64_t bytes = 0;  // As requested from operator new
+
+    AllocCounts& operator+=(const AllocCounts& other) {
+        allocations += other.allocations;
+        bytes += other.bytes;
+        return *this;
+    }
+    friend AllocCounts operator-(const AllocCounts& a, const AllocCounts& b) {
+        return AllocCounts{a.allocations - b.allocations, a.bytes - b.bytes};
+    }
+};
+
+// Everything the calling thread allocated since it started. Take the difference of two calls to
+// attribute allocations to the code in between.
+AllocCounts ThreadAllocCounts();
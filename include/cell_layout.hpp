@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "coordinates.hpp"
+
+// How the per-cell planes of a search map a width x height grid onto a flat array.
+// Reset() sets the grid size, Size() is the number of slots to allocate, Index() and At() convert both ways.
+// Indices fit 32 bits on every grid we can search.
+
+// Row after row. Horizontal neighbours are adjacent, vertical ones a whole row apart.
+class RowMajorLayout {
+public:
+    static constexpr const char* kName = "row_major";
+
+    void Reset(int width, int height) {
+        width_ = width;
+        height_ = height;
+    }
+    std::size_t Size() const {
+        return static_cast<std::size_t>(width_) * height_;
+    }
+    std::size_t Index(Coordinates at) const {
+        return static_cast<std::size_t>(at.y) * width_ + at.x;
+    }
+    Coordinates At(std::uint32_t index) const {
+        return Coordinates{static_cast<int>(index % width_), static_cast<int>(index / width_)};
+    }
+
+private:
+    int width_ = 0, height_ = 0;
+};
+
+// 8x8 tiles in row-major order, row-major within a tile. All four neighbours of a cell share its tile unless it
+// is on the tile's border, so a search that spreads out in every direction touches far fewer cache lines
+// and pages on wide maps. Grids are padded up to whole tiles.
+class TiledLayout {
+public:
+    static constexpr const char* kName = "tiled";
+
+    void Reset(int width, int height) {
+        tiles_x_ = (width + kTileSide - 1) / kTileSide;
+        tiles_y_ = (height + kTileSide - 1) / kTileSide;
+    }
+    std::size_t Size() const {
+        return static_cast<std::size_t>(tiles_x_) * tiles_y_ * kTileCells;
+    }
+    std::size_t Index(Coordinates at) const {
+        const std::size_t tile = static_cast<std::size_t>(at.y >> kTileShift) * tiles_x_ + (at.x >> kTileShift);
+        return tile << (2 * kTileShift) | (at.y & (kTileSide - 1)) << kTileShift | (at.x & (kTileSide - 1));
+    }
+    Coordinates At(std::uint32_t index) const {
+        const std::uint32_t tile = index >> (2 * kTileShift);
+        const int x = static_cast<int>(tile % tiles_x_) << kTileShift | (index & (kTileSide - 1));
+        const int y = static_cast<int>(tile / tiles_x_) << kTileShift | ((index >> kTileShift) & (kTileSide - 1));
+        return Coordinates{x, y};
+    }
+
+private:
+    static constexpr int kTileShift = 3;
+    static constexpr int kTileSide = 1 << kTileShift;
+    static constexpr int kTileCells = kTileSide * kTileSide;
+
+    int tiles_x_ = 0, tiles_y_ = 0;
+};
+
+// Picked at configure time with -DCELL_LAYOUT=row_major|tiled
+#ifdef PATHFINDING_TILED_LAYOUT
+using CellLayout = TiledLayout;
+#else
+using CellLayout = RowMajorLayout;
+#endif
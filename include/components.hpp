@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "coordinates.hpp"
+#include "grid.hpp"
+#include "search_workspace.hpp"
+
+// Label of obstacle cells
+constexpr std::uint32_t kNoComponent = ~std::uint32_t{0};
+
+// Grids with at least this many cells are labelled on all hardware threads
+constexpr std::size_t kParallelLabelCells = std::size_t{1} << 18;
+
+// Connected components of the free cells of a grid, 4-connected like the searches. Start and goal in different
+// components can't have a path, IsConnected() tells so in near O(1) instead of flooding the start's region.
+// Build() labels a whole grid, in bands of rows on all hardware threads for large grids. SetObstacle() then
+// follows single edits: freeing a cell unites the components around it, blocking one floods from each of its
+// free neighbours in lockstep and stops once at most one flood still grows, so only pieces that got cut off are
+// visited and relabelled. Only the owner thread of the grid may use it.
+class ComponentIndex {
+public:
+    // Grid is OccupancyGrid, GridSnapshot or BitGridView
+    template <typename Grid>
+    void Build(const Grid& grid);
+    // Takes the labels of a grid as Labels() returned them instead of labelling it. Returns false and leaves the
+    // index alone unless they fit: obstacles unlabelled, neighbouring free cells equal, every label naming a free
+    // cell that carries it and comes first. Two separate regions sharing a label aren't caught, that takes a Build().
+    template <typename Grid>
+    bool Assign(const Grid& grid, const std::vector<std::uint32_t>& labels);
+    // Every cell's component, row-major, kNoComponent for obstacles. A component is named by its first cell, so
+    // the same grid gives the same labels whichever edits led to it.
+    std::vector<std::uint32_t> Labels();
+    // Mirrors an edit of the grid the index was built from
+    void SetObstacle(int x, int y, bool obstacle);
+
+    bool IsConnected(Coordinates a, Coordinates b);
+    // kNoComponent for obstacles. Labels change with edits, only compare them between two edits.
+    std::uint32_t Component(Coordinates at);
+    std::size_t ComponentCount() const {
+        return component_count_;
+    }
+    // Cells that the last SetObstacle() visited
+    std::size_t LastUpdateCells() const {
+        return last_update_cells_;
+    }
+    std::size_t MemoryBytes() const;
+
+private:
+    // Which flood of a split reached a cell
+    struct Mark {
+        std::uint32_t epoch;
+        std::uint8_t flood;
+    };
+
+    std::size_t Index(int x, int y) const {
+        return static_cast<std::size_t>(y) * width_ + x;
+    }
+    // Union-find over labels with path halving
+    std::uint32_t Find(std::uint32_t label);
+    std::uint32_t NewLabel();
+    // Renames every component after its first cell as Build() does, dropping labels no cell uses any more
+    void Compact();
+    // Free cells among the four neighbours of a cell
+    int FreeNeighbors(std::size_t index, std::array<std::uint32_t, 4>& neighbors) const;
+    void Split(const std::array<std::uint32_t, 4>& neighbors, int count);
+
+    int width_ = 0, height_ = 0;
+    std::vector<std::uint32_t> labels_;   // Per cell, row-major, kNoComponent for obstacles
+    std::vector<std::uint32_t> parents_;  // Per label, a root is its own parent
+    std::size_t component_count_ = 0;
+    std::size_t last_update_cells_ = 0;
+
+    // Scratch of Split(), kept from edit to edit
+    MonotonicArena arena_;
+    EpochArray<Mark> marks_;
+    std::array<std::vector<std::uint32_t>, 4> floods_;  // Cells each flood reached, in the order it did
+};
+
+// Defined in components.cpp for these grids only
+extern template void ComponentIndex::Build<OccupancyGrid>(const OccupancyGrid& grid);
+extern template void ComponentIndex::Build<GridSnapshot>(const GridSnapshot& grid);
+extern template void ComponentIndex::Build<BitGridView>(const BitGridView& grid);
+extern template bool ComponentIndex::Assign<OccupancyGrid>(const OccupancyGrid& grid,
+                                                           const std::vector<std::uint32_t>& labels);
+extern template bool ComponentIndex::Assign<GridSnapshot>(const GridSnapshot& grid,
+                                                          const std::vector<std::uint32_t>& labels);
+extern template bool ComponentIndex::Assign<BitGridView>(const BitGridView& grid, const std::vector<std::uint32_t>& labels);
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <tuple>
+
+struct Coordinates {
+    int x, y;
+    friend constexpr bool operator==(const Coordinates& a, const Coordinates& b) {
+        return a.x == b.x && a.y == b.y;
+    }
+    friend constexpr bool operator!=(const Coordinates& a, const Coordinates& b) {
+        return !(a == b);
+    }
+    friend bool operator<(const Coordinates& a, const Coordinates& b) {
+        return std::tie(a.x, a.y) < std::tie(b.x, b.y);
+    }
+};
+
+// The four moves on the grid, in the order the searches try them. Fits into 2 bits.
+enum class Direction : std::uint8_t { kEast, kWest, kNorth, kSouth };
+
+constexpr Coordinates Neighbor(Coordinates at, Direction direction) {
+    switch (direction) {
+        case Direction::kEast:
+            return Coordinates{at.x + 1, at.y};
+        case Direction::kWest:
+            return Coordinates{at.x - 1, at.y};
+        case Direction::kNorth:
+            return Coordinates{at.x, at.y - 1};
+        default:
+            return Coordinates{at.x, at.y + 1};
+    }
+}
+
+// Direction of the move from one cell to an adjacent one
+constexpr Direction DirectionTo(Coordinates from, Coordinates to) {
+    if (to.x > from.x) {
+        return Direction::kEast;
+    } else if (to.x < from.x) {
+        return Direction::kWest;
+    } else if (to.y < from.y) {
+        return Direction::kNorth;
+    } else {
+        return Direction::kSouth;
+    }
+}
+
+// "custom specialization of std::hash can be injected in namespace std"
+// Implement hash to use Coordinates as unordered_map key
+namespace std {
+template <>
+struct hash<Coordinates> {
+    std::size_t operator()(const Coordinates& id) const noexcept {
+        return std::hash<int>()(id.x ^ (id.y << 4));
+    }
+};
+}  // namespace std
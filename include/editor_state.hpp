@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "search.hpp"
+
+// Precomputed data stored along with a map, so loading it doesn't have to derive it again.
+// Readers skip tags they don't know.
+struct EditorIndex {
+    std::uint32_t tag;
+    std::vector<std::uint8_t> data;
+};
+
+// Connected components of the free cells, see ComponentIndex::Labels()
+constexpr std::uint32_t kComponentLabelsTag = 1;
+
+// Everything needed to restore the editor
+struct EditorState {
+    int width = 0;
+    int height = 0;
+    std::vector<std::uint8_t> obstacles;  // Row-major, 1 for an obstacle
+    Coordinates start{0, 0};
+    Coordinates goal{0, 0};
+    Algorithm algorithm = Algorithm::kBfs;
+    std::vector<EditorIndex> indices;
+};
+
+// Larger states are rejected before anything is allocated for them
+constexpr int kMaxEditorStateSide = 16384;
+constexpr std::size_t kMaxEditorStateCells = std::size_t{1} << 24;
+
+// File layout (.spmap), all integers little endian:
+//   magic "SPMAP", format version, width, height, start, goal, algorithm, index count
+//   obstacle runs: varint count, then varint run lengths alternating free/obstacle, starting with free
+//   per index: tag, varint byte count, bytes
+// Both throw std::runtime_error if the file can't be accessed or is malformed.
+void SaveEditorState(const std::string& path, const EditorState& state);
+EditorState LoadEditorState(const std::string& path);
+
+// nullptr if the state has no index with that tag
+const EditorIndex* FindEditorIndex(const EditorState& state, std::uint32_t tag);
+// Per-cell 32-bit labels in row-major order as varint pairs of run length and label. A label holds over a run of
+// free cells, so this costs a few bytes per obstacle run rather than four per cell.
+EditorIndex EncodeLabelIndex(std::uint32_t tag, const std::vector<std::uint32_t>& labels);
+// False if the data is malformed or doesn't hold exactly cells labels
+bool DecodeLabelIndex(const EditorIndex& index, std::size_t cells, std::vector<std::uint32_t>& labels);
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <utility>
+
+// Minimal lazy C++20 generator, a stand-in for std::generator.
+// Values are produced when the consumer asks for them, destroying the generator stops the coroutine.
+template <typename T>
+class Generator {
+public:
+    struct promise_type {
+        const T* current = nullptr;
+        std::exception_ptr exception;
+
+        Generator get_return_object() {
+            return Generator(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+        std::suspend_always final_suspend() noexcept {
+            return {};
+        }
+        // The value lives in the coroutine frame until the next resume, so pointing to it is enough
+        std::suspend_always yield_value(const T& value) noexcept {
+            current = &value;
+            return {};
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() {
+            exception = std::current_exception();
+        }
+    };
+
+    using Handle = std::coroutine_handle<promise_type>;
+
+    class Iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+
+        Iterator() = default;
+        explicit Iterator(Handle handle) : handle_(handle) {}
+
+        const T& operator*() const {
+            return *handle_.promise().current;
+        }
+        const T* operator->() const {
+            return handle_.promise().current;
+        }
+        Iterator& operator++() {
+            Advance(handle_);
+            return *this;
+        }
+        void operator++(int) {
+            ++*this;
+        }
+        friend bool operator==(const Iterator& it, std::default_sentinel_t) {
+            return !it.handle_ || it.handle_.done();
+        }
+
+    private:
+        Handle handle_;
+    };
+
+    explicit Generator(Handle handle) : handle_(handle) {}
+    Generator(Generator&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+    Generator& operator=(Generator&& other) noexcept {
+        if (this != &other) {
+            Reset();
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+    Generator(const Generator&) = delete;
+    Generator& operator=(const Generator&) = delete;
+    ~Generator() {
+        Reset();
+    }
+
+    Iterator begin() {
+        Advance(handle_);
+        return Iterator(handle_);
+    }
+    std::default_sentinel_t end() {
+        return {};
+    }
+
+private:
+    static void Advance(Handle handle) {
+        handle.resume();
+        if (handle.done() && handle.promise().exception) {
+            std::rethrow_exception(handle.promise().exception);
+        }
+    }
+    void Reset() {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    Handle handle_;
+};
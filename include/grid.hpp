@@ -0,0 +1,139 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Cells per chunk side. A chunk is the unit that gets copied when a shared grid is edited.
+constexpr int kChunkSide = 16;
+
+class BitGridView;
+class GridSnapshot;
+
+// Live obstacle grid that is only edited by its owner thread.
+// The cells are split into chunks that are shared with every snapshot taken from the grid,
+// so Snapshot() is O(1) and the first edit after it copies the chunk table and the touched chunk only.
+class OccupancyGrid {
+public:
+    OccupancyGrid(int width, int height);
+
+    int Width() const {
+        return width_;
+    }
+    int Height() const {
+        return height_;
+    }
+    // Bumped by every edit that changes a cell
+    std::uint64_t Version() const {
+        return version_;
+    }
+
+    bool IsObstacle(int x, int y) const;
+    void SetObstacle(int x, int y, bool obstacle);
+    void Clear();
+    // Overwrites every cell from a bit plane of the same size, one chunk row at a time
+    void Assign(const BitGridView& bits);
+
+    GridSnapshot Snapshot();
+
+    // Chunk table plus every distinct chunk it points to, including the ones shared with snapshots
+    std::size_t MemoryBytes() const;
+
+private:
+    struct Chunk {
+        std::array<std::uint8_t, kChunkSide * kChunkSide> cells{};
+    };
+    // Chunks reachable from a snapshot are never written, see MutableChunk()
+    using ChunkTable = std::vector<std::shared_ptr<Chunk>>;
+
+    static int CellIndex(int x, int y) {
+        return (y % kChunkSide) * kChunkSide + x % kChunkSide;
+    }
+    int ChunkIndex(int x, int y) const {
+        return (y / kChunkSide) * chunks_x_ + x / kChunkSide;
+    }
+    Chunk& MutableChunk(int chunk_index);
+
+    int width_, height_;
+    int chunks_x_;
+    std::uint64_t version_;
+
+    // Instead of trusting shared_ptr::use_count(), which another thread may change under our feet,
+    // everything is treated as shared once a snapshot was taken. Snapshot() bumps snapshot_epoch_,
+    // copies made afterwards are stamped with it and may be written in place.
+    std::uint64_t snapshot_epoch_;
+    std::uint64_t table_epoch_;
+    std::vector<std::uint64_t> chunk_epochs_;
+    std::shared_ptr<ChunkTable> table_;
+
+    friend class GridSnapshot;
+};
+
+// Immutable view of an OccupancyGrid at one version. Cheap to copy and safe to read from any thread.
+class GridSnapshot {
+public:
+    GridSnapshot() = default;
+
+    int Width() const {
+        return width_;
+    }
+    int Height() const {
+        return height_;
+    }
+    std::uint64_t Version() const {
+        return version_;
+    }
+    bool IsObstacle(int x, int y) const {
+        const auto& chunk = (*table_)[(y / kChunkSide) * chunks_x_ + x / kChunkSide];
+        return chunk->cells[OccupancyGrid::CellIndex(x, y)] != 0;
+    }
+
+private:
+    GridSnapshot(std::shared_ptr<const OccupancyGrid::ChunkTable> table, int width, int height, int chunks_x,
+                 std::uint64_t version)
+        : table_(std::move(table)), width_(width), height_(height), chunks_x_(chunks_x), version_(version) {}
+
+    std::shared_ptr<const OccupancyGrid::ChunkTable> table_;
+    int width_ = 0;
+    int height_ = 0;
+    int chunks_x_ = 0;
+    std::uint64_t version_ = 0;
+
+    friend class OccupancyGrid;
+};
+
+// Read-only row-major bit plane owned by someone else, e.g. a memory-mapped grid file.
+// Bit x % 64 of word y * stride_words + x / 64 is set for an obstacle.
+class BitGridView {
+public:
+    BitGridView() = default;
+    BitGridView(const std::uint64_t* words, int width, int height, std::size_t stride_words, std::uint64_t version = 0)
+        : words_(words), width_(width), height_(height), stride_words_(stride_words), version_(version) {}
+
+    int Width() const {
+        return width_;
+    }
+    int Height() const {
+        return height_;
+    }
+    std::uint64_t Version() const {
+        return version_;
+    }
+    bool IsObstacle(int x, int y) const {
+        const std::uint64_t word = Row(y)[x / 64];
+        return (word >> (x % 64)) & 1u;
+    }
+    const std::uint64_t* Row(int y) const {
+        return words_ + static_cast<std::size_t>(y) * stride_words_;
+    }
+
+private:
+    const std::uint64_t* words_ = nullptr;
+    int width_ = 0;
+    int height_ = 0;
+    std::size_t stride_words_ = 0;
+    std::uint64_t version_ = 0;
+};
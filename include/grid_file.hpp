@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "grid.hpp"
+
+// Binary grid format that is meant to be mapped into memory as is:
+//   [0, 64)                  GridFileHeader
+//   [occupancy_offset, ...)  one bit per cell, rows padded to whole 64-bit words, page aligned
+//   [cost_offset, ...)       optional, one byte per cell, rows padded to 64 bytes, page aligned
+// All integers, the occupancy words included, are little endian. Offsets are multiples of kGridFilePageSize and
+// width and height fit an int. Mapping a file needs a little-endian host, the occupancy plane is used in place.
+struct GridFileHeader {
+    char magic[8];
+    std::uint32_t format_version;
+    std::uint32_t flags;
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint64_t occupancy_offset;
+    std::uint64_t occupancy_stride_words;
+    std::uint64_t cost_offset;
+    std::uint64_t cost_stride_bytes;
+    std::uint8_t reserved[8];
+};
+static_assert(sizeof(GridFileHeader) == 64, "GridFileHeader is part of the file format");
+
+constexpr char kGridFileMagic[8] = {'S', 'P', 'G', 'R', 'I', 'D', '\0', '\0'};
+constexpr std::uint32_t kGridFileVersion = 1;
+constexpr std::uint32_t kGridFileHasCosts = 1u << 0;
+constexpr std::size_t kGridFilePageSize = 4096;
+
+// costs holds one byte per cell in row-major order or is empty.
+// Throws std::runtime_error if the file can't be written.
+void WriteGridFile(const std::string& path, const GridSnapshot& grid, const std::vector<std::uint8_t>& costs = {});
+
+// Read-only mapping of a grid file. Opening it costs the same no matter how big the map is,
+// pages are only read when the search touches them and are shared with every other process
+// mapping the same file through the page cache.
+class MappedGrid {
+public:
+    // Throws std::runtime_error if the file can't be mapped or isn't a valid grid file
+    explicit MappedGrid(const std::string& path);
+    ~MappedGrid();
+    MappedGrid(MappedGrid&& other) noexcept;
+    MappedGrid& operator=(MappedGrid&& other) noexcept;
+    MappedGrid(const MappedGrid&) = delete;
+    MappedGrid& operator=(const MappedGrid&) = delete;
+
+    int Width() const {
+        return static_cast<int>(header_.width);
+    }
+    int Height() const {
+        return static_cast<int>(header_.height);
+    }
+    // Valid as long as this MappedGrid lives
+    BitGridView View() const;
+
+    bool HasCosts() const {
+        return (header_.flags & kGridFileHasCosts) != 0;
+    }
+    std::uint8_t Cost(int x, int y) const;
+
+private:
+    void Unmap();
+
+    void* mapping_ = nullptr;
+    const std::uint8_t* data_ = nullptr;
+    std::size_t size_ = 0;
+    GridFileHeader header_{};  // Decoded to host byte order
+};
@@ -1,8 +1,22 @@
 #pragma once
 
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "alloc_tracker.hpp"
+#include "components.hpp"
+#include "editor_state.hpp"
+#include "grid.hpp"
+#include "map_generators.hpp"
+#include "presets.hpp"
 #include "search.hpp"
+#include "search_worker.hpp"
+#include "tile.hpp"
 
 // GUI measurements in pixel
 constexpr int kScreenWidth = 1360;
@@ -10,11 +24,35 @@ constexpr int kScreenHeight = 830;
 
 constexpr int kTileLength = 25.0f;
 
-// Max grid rows and columns
-constexpr int kMaxTilesY = 25;  // Rows
-constexpr int kMaxTilesX = 50;  // Columns
+// Frames kept for the HUD's frame-time graph
+constexpr std::size_t kHudFrames = 120;
 
-enum class Algorithm { kBfs, kDijkstra, kAStar };
+// What the heatmap overlay shows on the visited tiles
+enum class HeatmapMode { kOff, kExpansions, kPushes };
+
+// A query of the live preview. The grid version is part of it, so no edit can hand out a stale path.
+struct PreviewKey {
+    Algorithm algorithm;
+    Coordinates start, goal;
+    std::uint64_t version;
+    friend bool operator==(const PreviewKey& a, const PreviewKey& b) = default;
+};
+
+struct PreviewKeyHash {
+    std::size_t operator()(const PreviewKey& key) const noexcept {
+        const std::hash<Coordinates> hash;
+        return (hash(key.start) * 31 + hash(key.goal)) * 3 + static_cast<std::size_t>(key.algorithm);
+    }
+};
+
+// Outcome of a finished preview query
+struct PreviewResult {
+    bool found = false;
+    std::vector<Coordinates> path;  // Goal first, the start left out
+    std::chrono::nanoseconds latency{0};  // Search time summed over the frames it took
+    std::size_t frames = 0;
+    std::size_t nodes_expanded = 0;
+};
 
 class Gui {
 public:
@@ -23,14 +61,34 @@ public:
     void RunLoop();
 
 private:
+    void LoadFonts();
     void ProcessInput();
+    void ProcessKeys();
+    void ProcessSearchEvents();
+    // Both run on the GUI thread and share frame_budget_, StepSlicedSearch() returns what it left of budget
+    std::chrono::microseconds StepSlicedSearch(std::chrono::microseconds budget);
+    void StepPreview(std::chrono::microseconds budget);
+    void ApplySearchEvent(const SearchEvent& event);
     void GenerateOutput();
+    void GenerateStatusLine();
+    void GenerateStatsPanel();
+    void GenerateHud();
+    void GenerateHeatmap();
+    void GeneratePreview();
+    void SampleHudCounters();
     void ClearGrid();
     void PurgeGrid();
+    // Turns the path back into explored cells, for a search that grows the same tree
+    void PurgePath();
+    bool CanReuseSearchTree() const;
+    void SetObstacle(Tile& tile, bool obstacle);
+    bool IsGoalReachable();
     Rectangle GetTileToOutline();
-    void PrintPreset(const std::vector<std::vector<int>>& vec);
+    void ApplyPreset(const PresetMap& preset);
+    void ApplyGeneratedMap(MapGenerator generator);
 
     void ProcessPresetButton(const Vector2& mouse_pos, Tile* button);
+    void ProcessGeneratorButton(const Vector2& mouse_pos, Tile* button, MapGenerator generator);
     void ProcessAlgorithmButton(const Vector2& mouse_pos, Tile* button);
     void ProcessActionButton(const Vector2& mouse_pos, Tile* button);
 
@@ -38,13 +96,86 @@ private:
     void GenerateAlgorithmButton(const Vector2& mouse_pos, const Tile* button);
     void OutlineAlgorithmButton();
     void GenerateActionButton(const Vector2& mouse_pos, const Tile* button, Color color);
+    void StartSearch();
+    bool IsSearchRunning() const;
+    void AbortSearch();
+    void SaveState(const std::string& path);
+    void LoadState(const std::string& path);
+    void DumpProfile();
+    EditorState CaptureState() const;
+    void ApplyState(const EditorState& state);
+
+    OccupancyGrid occupancy_;  // Mirrors the obstacle tiles, searches run on snapshots of it
+    ComponentIndex components_;  // Of occupancy_, rebuilt after bulk changes and updated with single edits
+    SearchEventQueue search_events_;
+    SearchWorker search_worker_;  // Declared after the queue it writes to
+    std::uint32_t search_job_;    // Job whose events get applied, 0 if none
+
+    // Time-sliced mode runs the search on the GUI thread for a fixed budget per frame instead
+    bool is_time_sliced_;
+    bool is_sliced_search_running_;
+    PerfCounters perf_counters_;  // Of the GUI thread, where sliced_search_ runs
+    Search sliced_search_;
+    std::vector<SearchEvent> sliced_events_;
+    std::chrono::microseconds frame_budget_;
+    std::size_t steps_per_frame_;  // Keeps the animation watchable on small maps
+
+    // Statistics of the last finished search, the threaded ones are fetched once its kDone arrived
+    SearchStats search_stats_;
+    bool has_search_stats_;
+    std::uint32_t stats_job_;
+
+    // Tree of the last search, finished and still on screen. A BFS or Dijkstra search with the same start on the
+    // same grid version grows it instead of starting over, so dragging the goal across explored cells is instant.
+    bool has_search_tree_;
+    Algorithm tree_algorithm_;
+    Coordinates tree_start_;
+    std::uint64_t tree_version_;
+
+    // Live preview, toggled with L. While start or goal is dragged a search on the GUI thread recomputes the path
+    // within what a time-sliced search leaves of frame_budget_ per frame. Finished queries are cached, one that
+    // runs out of budget goes on next frame and the last valid path stays up, dimmed, until it is done.
+    bool is_preview_enabled_;
+    bool is_preview_running_;  // preview_search_ has a query for preview_key_ in progress
+    bool is_preview_current_;  // preview_ answers the positions on screen
+    Search preview_search_;  // Emits no events, only the path is shown
+    PreviewKey preview_key_;
+    std::chrono::nanoseconds preview_latency_;  // Of the running query so far
+    std::size_t preview_frames_;
+    PreviewKey shown_key_;  // What preview_ answers
+    PreviewResult preview_;
+    bool has_preview_;
+    std::uint64_t preview_cache_version_;  // Grid version of every cached result
+    std::unordered_map<PreviewKey, PreviewResult, PreviewKeyHash> preview_cache_;
+
+    // Heatmap overlay, cycled with M. The threaded counters arrive with the statistics,
+    // the time-sliced ones are read live from sliced_search_.
+    HeatmapMode heatmap_mode_;
+    CellCounters cell_counters_;
+
+    // Performance HUD, toggled with H. Times are in milliseconds.
+    struct FrameTimes {
+        float input = 0, search = 0, render = 0, present = 0;
+    };
+    bool is_hud_visible_;
+    std::array<FrameTimes, kHudFrames> frame_times_;
+    std::array<AllocCounts, kHudFrames> frame_allocations_;  // Of the GUI thread, see alloc_tracker.hpp
+    std::size_t frame_index_;                               // Slot of the next frame
+    std::chrono::steady_clock::time_point present_begin_;  // Set by GenerateOutput() right before EndDrawing()
+    std::size_t queue_depth_;                               // Events waiting when the frame started
+    std::chrono::steady_clock::time_point hud_sample_time_;
+    std::size_t hud_sample_nodes_;
+    double nodes_per_second_;
+    std::size_t resident_bytes_;  // Whole process, 0 where it can't be read
+
+    std::string status_message_;  // Outcome of the last save, load, generated map, profile dump or rejected search
+    std::uint64_t generator_seed_;  // Every click on a generator button draws the next seed
 
-    Search search_;
     Font font_default_ = { 0 };
     Font font_unicode_ = { 0 };
 
     Vector2 mouse_position_;
-    TileState origin_state_;
+    TileState origin_state_;  // What the goal tile covers, restored when the goal moves on
     Tile* start_ptr_;
     Tile* goal_ptr_;
     Algorithm algorithm_;
@@ -52,6 +183,7 @@ private:
     Tile preset_button1_;
     Tile preset_button2_;
     Tile preset_button3_;
+    std::array<Tile, kAllMapGenerators.size()> generator_buttons_;
 
     Tile vector_field_button_;
 
@@ -65,52 +197,7 @@ private:
     bool start_button_drag_;
     bool goal_button_drag_;
     bool search_executed_;
-    bool is_gui_busy_;
     bool is_vector_field_;
 
     std::vector<std::vector<Tile>> grid_;
-
-    // boilerplate coordinates for presets
-    std::vector<std::vector<int>> preset_vec1_{
-        {0, 38},  {0, 39},  {0, 40},  {0, 41},  {1, 38},  {1, 39},  {1, 40},  {1, 41},  {2, 38},  {2, 39},  {2, 40},  {2, 41},
-        {3, 3},   {3, 4},   {3, 5},   {3, 6},   {3, 7},   {3, 8},   {3, 9},   {3, 38},  {3, 39},  {3, 40},  {3, 41},  {4, 3},
-        {4, 4},   {4, 5},   {4, 6},   {4, 7},   {4, 8},   {4, 9},   {4, 38},  {4, 39},  {4, 40},  {4, 41},  {5, 3},   {5, 4},
-        {5, 5},   {5, 6},   {5, 7},   {5, 8},   {5, 9},   {5, 38},  {5, 39},  {5, 40},  {5, 41},  {6, 3},   {6, 4},   {6, 5},
-        {6, 6},   {6, 7},   {6, 8},   {6, 9},   {6, 18},  {6, 19},  {6, 20},  {6, 21},  {6, 22},  {6, 23},  {6, 24},  {6, 25},
-        {6, 26},  {6, 38},  {6, 39},  {6, 40},  {6, 41},  {7, 3},   {7, 4},   {7, 5},   {7, 6},   {7, 7},   {7, 8},   {7, 9},
-        {7, 18},  {7, 19},  {7, 20},  {7, 21},  {7, 22},  {7, 23},  {7, 24},  {7, 25},  {7, 26},  {7, 38},  {7, 39},  {7, 40},
-        {7, 41},  {8, 3},   {8, 4},   {8, 5},   {8, 6},   {8, 7},   {8, 8},   {8, 9},   {8, 18},  {8, 19},  {8, 20},  {8, 21},
-        {8, 22},  {8, 23},  {8, 24},  {8, 25},  {8, 26},  {8, 38},  {8, 39},  {8, 40},  {8, 41},  {8, 42},  {8, 43},  {8, 44},
-        {8, 45},  {9, 3},   {9, 4},   {9, 5},   {9, 6},   {9, 7},   {9, 8},   {9, 9},   {9, 18},  {9, 19},  {9, 20},  {9, 21},
-        {9, 22},  {9, 23},  {9, 24},  {9, 25},  {9, 26},  {9, 38},  {9, 39},  {9, 40},  {9, 41},  {9, 42},  {9, 43},  {9, 44},
-        {9, 45},  {10, 3},  {10, 4},  {10, 5},  {10, 6},  {10, 7},  {10, 8},  {10, 9},  {10, 18}, {10, 19}, {10, 20}, {10, 21},
-        {10, 22}, {10, 23}, {10, 24}, {10, 25}, {10, 26}, {10, 38}, {10, 39}, {10, 40}, {10, 41}, {10, 42}, {10, 43}, {10, 44},
-        {10, 45}, {11, 3},  {11, 4},  {11, 5},  {11, 6},  {11, 7},  {11, 8},  {11, 9},  {11, 18}, {11, 19}, {11, 20}, {11, 21},
-        {11, 22}, {11, 23}, {11, 24}, {11, 25}, {11, 26}, {11, 38}, {11, 39}, {11, 40}, {11, 41}, {11, 42}, {11, 43}, {11, 44},
-        {11, 45}, {12, 3},  {12, 4},  {12, 5},  {12, 6},  {12, 7},  {12, 8},  {12, 9},  {12, 18}, {12, 19}, {12, 20}, {12, 21},
-        {12, 22}, {12, 23}, {12, 24}, {12, 25}, {12, 26}, {13, 3},  {13, 4},  {13, 5},  {13, 6},  {13, 7},  {13, 8},  {13, 9},
-        {13, 18}, {13, 19}, {13, 20}, {13, 21}, {13, 22}, {13, 23}, {13, 24}, {13, 25}, {13, 26}, {14, 3},  {14, 4},  {14, 5},
-        {14, 6},  {14, 7},  {14, 8},  {14, 9},  {14, 18}, {14, 19}, {14, 20}, {14, 21}, {14, 22}, {14, 23}, {14, 24}, {14, 25},
-        {14, 26}, {15, 3},  {15, 4},  {15, 5},  {15, 6},  {15, 7},  {15, 8},  {15, 9},  {15, 18}, {15, 19}, {15, 20}, {15, 21},
-        {15, 22}, {15, 23}, {15, 24}, {15, 25}, {15, 26}, {16, 3},  {16, 4},  {16, 5},  {16, 6},  {16, 7},  {16, 8},  {16, 9},
-        {16, 18}, {16, 19}, {16, 20}, {16, 21}, {16, 22}, {16, 23}, {16, 24}, {16, 25}, {16, 26}, {17, 3},  {17, 4},  {17, 5},
-        {17, 6},  {17, 7},  {17, 8},  {17, 9},  {17, 18}, {17, 19}, {17, 20}, {17, 21}, {17, 22}, {17, 23}, {17, 24}, {17, 25},
-        {17, 26}, {18, 3},  {18, 4},  {18, 5},  {18, 6},  {18, 7},  {18, 8},  {18, 9},  {18, 18}, {18, 19}, {18, 20}, {18, 21},
-        {18, 22}, {18, 23}, {18, 24}, {18, 25}, {18, 26}, {19, 3},  {19, 4},  {19, 5},  {19, 6},  {19, 7},  {19, 8},  {19, 9},
-        {19, 18}, {19, 19}, {19, 20}, {19, 21}, {19, 22}, {19, 23}, {19, 24}, {19, 25}, {19, 26}, {20, 3},  {20, 4},  {20, 5},
-        {20, 6},  {20, 7},  {20, 8},  {20, 9},  {20, 18}, {20, 19}, {20, 20}, {20, 21}, {20, 22}, {20, 23}, {20, 24}, {20, 25},
-        {20, 26}, {21, 18}, {21, 19}, {21, 20}, {21, 21}, {21, 22}, {21, 23}, {21, 24}, {21, 25}, {21, 26}, {22, 18}, {22, 19},
-        {22, 20}, {22, 21}, {22, 22}, {22, 23}, {22, 24}, {22, 25}, {22, 26}, {23, 18}, {23, 19}, {23, 20}, {23, 21}, {23, 22},
-        {23, 23}, {23, 24}, {23, 25}, {23, 26}, {24, 18}, {24, 19}, {24, 20}, {24, 21}, {24, 22}, {24, 23}, {24, 24}, {24, 25},
-        {24, 26}};
-
-    std::vector<std::vector<int>> preset_vec2_{{6, 19},  {6, 20},  {6, 21},  {6, 22},  {6, 23},  {6, 24},  {6, 25},  {6, 26},
-                                               {6, 27},  {6, 28},  {6, 29},  {6, 30},  {7, 30},  {8, 30},  {9, 30},  {10, 30},
-                                               {11, 30}, {12, 30}, {13, 30}, {14, 30}, {15, 30}, {16, 30}, {17, 30}, {18, 14},
-                                               {18, 15}, {18, 16}, {18, 17}, {18, 18}, {18, 19}, {18, 20}, {18, 21}, {18, 22},
-                                               {18, 23}, {18, 24}, {18, 25}, {18, 26}, {18, 27}, {18, 28}, {18, 29}, {18, 30}};
-
-    std::vector<std::vector<int>> preset_vec3_{{6, 19},  {6, 29},  {7, 20},  {7, 28},  {8, 21},  {8, 27},  {9, 22},
-                                               {9, 26},  {10, 23}, {10, 25}, {11, 24}, {12, 23}, {12, 25}, {13, 22},
-                                               {13, 26}, {14, 21}, {14, 27}, {15, 20}, {15, 28}, {16, 19}, {16, 29}};
 };
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "grid.hpp"
+#include "search.hpp"
+
+// Seeded procedural maps for the editor and the benchmarks.
+// The same kind, size and seed always give the same map, no matter how many threads build it.
+
+enum class MapGenerator { kRandomFill, kRecursiveDivision, kDfsMaze, kRooms, kCave };
+
+constexpr std::array<MapGenerator, 5> kAllMapGenerators{MapGenerator::kRandomFill, MapGenerator::kRecursiveDivision,
+                                                        MapGenerator::kDfsMaze, MapGenerator::kRooms, MapGenerator::kCave};
+
+// "random", "division", "maze", "rooms" or "cave"
+const char* MapGeneratorName(MapGenerator generator);
+
+struct GeneratedMap {
+    int width = 0, height = 0;
+    std::vector<std::uint8_t> cells;  // Row-major, 1 for an obstacle
+    Coordinates start{}, goal{};      // Free cells near opposite corners, not necessarily connected
+
+    bool IsObstacle(int x, int y) const {
+        return cells[static_cast<std::size_t>(y) * width + x] != 0;
+    }
+    OccupancyGrid ToOccupancyGrid() const;
+};
+
+// Maps with at least this many cells are built on all hardware threads
+constexpr std::size_t kParallelGenerateCells = std::size_t{1} << 18;
+
+// density is the obstacle share of kRandomFill and the initial fill of kCave, the other kinds ignore it.
+// A negative density picks the default of the kind. Throws std::invalid_argument for maps below 3x3.
+GeneratedMap GenerateMap(MapGenerator generator, int width, int height, std::uint64_t seed, double density = -1.0);
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "grid.hpp"
+#include "search.hpp"
+
+// Loaders for the grid benchmark formats of the MovingAI lab (https://movingai.com/benchmarks/formats.html)
+
+// One query of a .scen file
+struct MovingAiScenario {
+    int bucket;
+    std::string map;  // As written in the file, usually relative to the .scen file
+    int map_width, map_height;
+    Coordinates start, goal;
+    double optimal_length;  // Octile distance with diagonal moves, so a 4-connected path is never shorter
+};
+
+// '.', 'G' and 'S' are passable, everything else ('@', 'O', 'T', 'W') is an obstacle.
+// Both throw std::runtime_error if the file can't be read or is malformed, which includes a scenario whose start
+// or goal lies off its map.
+OccupancyGrid LoadMovingAiMap(const std::string& path);
+std::vector<MovingAiScenario> LoadMovingAiScenarios(const std::string& path);
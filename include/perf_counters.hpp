@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// Where PerfCounts come from, from the most to the least detailed:
+//   kHardware  perf_event_open with the PMU, plus the kernel's software events
+//   kSoftware  perf_event_open software events only, e.g. in VMs without a virtual PMU
+//   kRusage    getrusage() and the thread CPU clock when perf_event_open is not allowed at all
+//   kNone      nothing measured, outside of Linux
+enum class PerfSource { kNone, kRusage, kSoftware, kHardware };
+
+// "none", "rusage", "software" or "hardware"
+const char* PerfSourceName(PerfSource source);
+
+struct PerfCounts {
+    PerfSource source = PerfSource::kNone;
+    // Only with kHardware, user space only
+    std::uint64_t instructions = 0;
+    std::uint64_t cycles = 0;
+    std::uint64_t cache_misses = 0;  // Last level cache
+    std::uint64_t branch_misses = 0;
+    // With every source but kNone
+    std::uint64_t task_clock_ns = 0;  // CPU time of the thread
+    std::uint64_t page_faults = 0;
+    std::uint64_t context_switches = 0;
+
+    PerfCounts& operator+=(const PerfCounts& other);
+};
+
+// Counts what the calling thread does while resumed, starting paused and at zero.
+// Counters are per thread, so create, resume, pause and read one on the thread it measures.
+// Opening picks the best PerfSource the kernel allows and never fails, it falls back instead.
+class PerfCounters {
+public:
+    PerfCounters();
+    ~PerfCounters();
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    PerfSource Source() const {
+        return source_;
+    }
+    void Reset();
+    void Resume();
+    void Pause();
+    PerfCounts Read() const;
+
+private:
+    static constexpr int kHardwareEvents = 4;  // instructions, cycles, cache misses, branch misses
+    static constexpr int kSoftwareEvents = 3;  // task clock, page faults, context switches
+
+    // Running totals as the kernel reports them, Read() returns the difference to the last Reset()
+    struct Raw {
+        std::array<std::uint64_t, kHardwareEvents> hardware{};
+        std::uint64_t hardware_enabled = 0, hardware_running = 0;  // For scaling multiplexed counters
+        std::array<std::uint64_t, kSoftwareEvents> software{};
+    };
+    Raw ReadRaw() const;
+
+    PerfSource source_;
+    std::array<int, kHardwareEvents> hardware_fds_;  // [0] leads the group, -1 if not open
+    std::array<int, kSoftwareEvents> software_fds_;
+    bool running_;
+    Raw baseline_;
+    Raw paused_;  // kRusage: totals collected while resumed so far
+    Raw resumed_at_;
+};
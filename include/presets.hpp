@@ -0,0 +1,148 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+
+#include "grid.hpp"
+#include "search.hpp"
+
+// Max grid rows and columns
+constexpr int kMaxTilesY = 25;  // Rows
+constexpr int kMaxTilesX = 50;  // Columns
+
+static_assert(kMaxTilesX <= 64, "A preset row is packed into a single word");
+
+// Obstacle layout of the editor grid, one word per row with bit x set for an obstacle.
+// The packed rows double as a BitGridView, so applying a preset is a bulk copy without allocating.
+struct PresetMap {
+    std::array<std::uint64_t, kMaxTilesY> rows{};
+    Coordinates start{};
+    Coordinates goal{};
+
+    constexpr bool IsObstacle(int x, int y) const {
+        return (rows[y] >> x) & 1u;
+    }
+    BitGridView View() const {
+        return BitGridView(rows.data(), kMaxTilesX, kMaxTilesY, 1);
+    }
+};
+
+using PresetArt = std::array<std::string_view, kMaxTilesY>;
+
+// Packs a drawing with '#' for obstacles and '.' for free tiles.
+// Only used in constant expressions, where reaching a throw is a compile error.
+constexpr PresetMap MakePreset(const PresetArt& art, Coordinates start, Coordinates goal) {
+    PresetMap preset;
+    for (int y = 0; y < kMaxTilesY; ++y) {
+        if (art[y].size() != static_cast<std::size_t>(kMaxTilesX)) {
+            throw std::logic_error("preset row doesn't match kMaxTilesX");
+        }
+        for (int x = 0; x < kMaxTilesX; ++x) {
+            if (art[y][x] == '#') {
+                preset.rows[y] |= std::uint64_t{1} << x;
+            } else if (art[y][x] != '.') {
+                throw std::logic_error("preset tiles must be '#' or '.'");
+            }
+        }
+    }
+    for (const Coordinates& at : {start, goal}) {
+        if (at.x < 0 || at.x >= kMaxTilesX || at.y < 0 || at.y >= kMaxTilesY || preset.IsObstacle(at.x, at.y)) {
+            throw std::logic_error("preset start and goal must be free tiles on the grid");
+        }
+    }
+    if (start == goal) {
+        throw std::logic_error("preset start and goal must differ");
+    }
+    preset.start = start;
+    preset.goal = goal;
+    return preset;
+}
+
+// clang-format off
+inline constexpr std::array<PresetMap, 3> kPresets{
+    MakePreset(PresetArt{
+        "......................................####........",
+        "......................................####........",
+        "......................................####........",
+        "...#######............................####........",
+        "...#######............................####........",
+        "...#######............................####........",
+        "...#######........#########...........####........",
+        "...#######........#########...........####........",
+        "...#######........#########...........########....",
+        "...#######........#########...........########....",
+        "...#######........#########...........########....",
+        "...#######........#########...........########....",
+        "...#######........#########.......................",
+        "...#######........#########.......................",
+        "...#######........#########.......................",
+        "...#######........#########.......................",
+        "...#######........#########.......................",
+        "...#######........#########.......................",
+        "...#######........#########.......................",
+        "...#######........#########.......................",
+        "...#######........#########.......................",
+        "..................#########.......................",
+        "..................#########.......................",
+        "..................#########.......................",
+        "..................#########......................."},
+        Coordinates{14, 14}, Coordinates{43, 1}),
+    MakePreset(PresetArt{
+        "..................................................",
+        "..................................................",
+        "..................................................",
+        "..................................................",
+        "..................................................",
+        "..................................................",
+        "...................############...................",
+        "..............................#...................",
+        "..............................#...................",
+        "..............................#...................",
+        "..............................#...................",
+        "..............................#...................",
+        "..............................#...................",
+        "..............................#...................",
+        "..............................#...................",
+        "..............................#...................",
+        "..............................#...................",
+        "..............................#...................",
+        "..............#################...................",
+        "..................................................",
+        "..................................................",
+        "..................................................",
+        "..................................................",
+        "..................................................",
+        ".................................................."},
+        Coordinates{12, 18}, Coordinates{27, 5}),
+    MakePreset(PresetArt{
+        "..................................................",
+        "..................................................",
+        "..................................................",
+        "..................................................",
+        "..................................................",
+        "..................................................",
+        "...................#.........#....................",
+        "....................#.......#.....................",
+        ".....................#.....#......................",
+        "......................#...#.......................",
+        ".......................#.#........................",
+        "........................#.........................",
+        ".......................#.#........................",
+        "......................#...#.......................",
+        ".....................#.....#......................",
+        "....................#.......#.....................",
+        "...................#.........#....................",
+        "..................................................",
+        "..................................................",
+        "..................................................",
+        "..................................................",
+        "..................................................",
+        "..................................................",
+        "..................................................",
+        ".................................................."},
+        Coordinates{14, 11}, Coordinates{34, 11})
+};
+// clang-format on
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Scoped-zone profiler. PROFILE_ZONE("name") times the rest of the enclosing block and records it in a
+// buffer of the calling thread. While recording is off a zone costs one relaxed load, building with
+// ENABLE_PROFILER=OFF removes the zones altogether.
+//
+// Every thread keeps its last kProfileBufferZones zones. Zone names must be string literals without
+// characters that need escaping in JSON.
+
+constexpr std::size_t kProfileBufferZones = std::size_t{1} << 16;
+
+extern std::atomic<bool> g_profiler_enabled;
+
+inline bool IsProfilerEnabled() {
+    return g_profiler_enabled.load(std::memory_order_relaxed);
+}
+void SetProfilerEnabled(bool enabled);
+
+// Both write what all threads recorded so far and throw std::runtime_error if the file can't be written.
+// The Chrome trace opens in chrome://tracing or Perfetto, the collapsed stacks feed flamegraph.pl with
+// the self time of each stack in microseconds.
+void WriteChromeTrace(const std::string& path);
+void WriteCollapsedStacks(const std::string& path);
+
+class ProfileZone {
+public:
+    explicit ProfileZone(const char* name) : name_(nullptr), begin_ns_(0), depth_(0) {
+        if (IsProfilerEnabled()) {
+            Open(name);
+        }
+    }
+    ~ProfileZone() {
+        if (name_ != nullptr) {
+            Close();
+        }
+    }
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    void Open(const char* name);
+    void Close();
+
+    const char* name_;  // nullptr if recording was off when the zone opened
+    std::uint64_t begin_ns_;
+    std::uint32_t depth_;
+};
+
+#ifdef PATHFINDING_PROFILER
+#define PROFILE_ZONE_CONCAT_INNER(a, b) a##b
+#define PROFILE_ZONE_CONCAT(a, b) PROFILE_ZONE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_ZONE_CONCAT(profile_zone_, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name) static_cast<void>(0)
+#endif
@@ -1,62 +1,259 @@
 #pragma once
 
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <functional>
-#include <queue>
+#include <memory>
+#include <mutex>
 #include <thread>
-#include <tuple>
-#include <unordered_map>
-#include <unordered_set>
 
-#include "tile.hpp"
+#include "alloc_tracker.hpp"
+#include "cell_layout.hpp"
+#include "coordinates.hpp"
+#include "generator.hpp"
+#include "grid.hpp"
+#include "perf_counters.hpp"
+#include "search_workspace.hpp"
+#include "spsc_queue.hpp"
 
-struct Coordinates {
-    int x, y;
-    friend bool operator==(const Coordinates& a, const Coordinates& b) {
-        return a.x == b.x && a.y == b.y;
+enum class Algorithm { kBfs, kDijkstra, kAStar };
+constexpr std::array<Algorithm, 3> kAllAlgorithms{Algorithm::kBfs, Algorithm::kDijkstra, Algorithm::kAStar};
+
+// Lower case names as used on the benchmark command lines
+const char* AlgorithmName(Algorithm algorithm);
+
+enum class SearchEventType { kVisit, kPath, kDone };
+
+// Everything the search thread reports back to the GUI thread
+struct SearchEvent {
+    SearchEventType type;
+    Coordinates at;
+    char arrow;             // Vector field glyph of a kVisit event
+    std::uint32_t job_id;   // Lets the GUI drop events of aborted jobs
+    std::uint64_t version;  // Grid version the search ran on, stale results get dropped
+};
+
+constexpr std::size_t kSearchEventQueueSize = 4096;
+using SearchEventQueue = SpscQueue<SearchEvent, kSearchEventQueueSize>;
+
+// Cooperative cancellation flag shared between the submitter and the running search.
+// Copies share the same state.
+class CancelToken {
+public:
+    CancelToken() : state_(std::make_shared<State>()) {}
+    void Cancel() const;
+    bool IsCancelled() const {
+        return state_->cancelled.load(std::memory_order_relaxed);
     }
-    friend bool operator!=(const Coordinates& a, const Coordinates& b) {
-        return !(a == b);
+    // Sleeps for at most duration but wakes up as soon as the token gets cancelled.
+    // Returns false if it was cancelled.
+    bool SleepFor(std::chrono::milliseconds duration) const;
+
+private:
+    struct State {
+        std::atomic<bool> cancelled{false};
+        std::mutex mutex;
+        std::condition_variable cv;
+    };
+    std::shared_ptr<State> state_;
+};
+
+// What one query cost. Filled in while the search runs, final once it is done.
+struct SearchStats {
+    std::size_t nodes_expanded = 0;    // Frontier pops that got expanded
+    std::size_t nodes_generated = 0;   // Passable neighbours looked at
+    std::size_t frontier_peak = 0;     // Most entries on the frontier at once
+    std::size_t duplicate_pushes = 0;  // Pushes of a node already on the frontier, after finding a cheaper way
+    std::size_t re_expansions = 0;     // Pops of a stale entry whose node was expanded with a lower cost before
+    bool resumed = false;              // Grew the tree of the previous query instead of starting over, see SetReuseTree()
+    std::size_t path_length = 0;       // Moves from start to goal
+    double path_cost = 0.0;
+    std::chrono::nanoseconds setup_time{0};           // Begin()
+    std::chrono::nanoseconds search_time{0};          // Expanding nodes and revealing the path
+    std::chrono::nanoseconds reconstruction_time{0};  // Following the parent directions back from the goal
+    std::size_t bytes_allocated = 0;  // Memory held by the search when done, see BasicSearch::MemoryBytes()
+    PerfCounts perf;                  // Begin() and Step() only, and only with SetPerfCounters()
+    AllocCounts allocations;          // Begin() and Step(), including growth of the caller's event buffer
+};
+
+// Per-cell work of one search, row-major over the grid. Empty unless the search counts cells.
+struct CellCounters {
+    int width = 0, height = 0;
+    std::vector<std::uint32_t> expansions;  // Pops that got expanded, more than one is a re-expansion
+    std::vector<std::uint32_t> pushes;      // Frontier pushes, more than one is a duplicate
+
+    bool IsEmpty() const {
+        return expansions.empty();
     }
-    friend bool operator<(const Coordinates& a, const Coordinates& b) {
-        return std::tie(a.x, a.y) < std::tie(b.x, b.y);
+    std::size_t Index(int x, int y) const {
+        return static_cast<std::size_t>(y) * width + x;
     }
 };
 
-// "custom specialization of std::hash can be injected in namespace std"
-// Implement hash to put Coordinates into an unordered_set
-namespace std {
-template <>
-struct hash<Coordinates> {
-    std::size_t operator()(const Coordinates& id) const noexcept {
-        return std::hash<int>()(id.x ^ (id.y << 4));
+// Live figures of a search running on another thread, refreshed after every step
+struct SearchProgress {
+    std::atomic<std::size_t> nodes_expanded{0};
+    std::atomic<std::size_t> memory_bytes{0};
+};
+
+// Where a running search reports to and how it gets stopped
+struct SearchChannel {
+    SearchEventQueue& events;
+    CancelToken token;
+    std::uint32_t job_id;
+    SearchProgress* progress = nullptr;  // Optional
+};
+
+// Passable neighbours of a cell, kept on the stack so expanding a node doesn't allocate
+struct NeighborList {
+    std::array<Coordinates, 4> cells;
+    std::size_t count = 0;
+
+    const Coordinates* begin() const {
+        return cells.data();
+    }
+    const Coordinates* end() const {
+        return cells.data() + count;
+    }
+    std::size_t size() const {
+        return count;
     }
 };
-}  // namespace std
 
-class Search {
+// Resumable search on an immutable view of the obstacles, it never touches the GUI grid.
+// Grid is GridSnapshot for the GUI or BitGridView for memory-mapped grid files; it has to provide
+// Width(), Height(), Version() and IsObstacle(x, y) and be cheap to copy.
+// Begin() sets up a query, Step() and RunFor() advance it and append what happened to an event buffer.
+// Pacing is up to the caller: Play() animates a whole search on the worker thread,
+// the GUI's time-sliced mode calls RunFor() once per frame instead.
+// Events() wraps the same stepping into a coroutine for consumers that want to pull events lazily.
+// With SetReuseTree() a BFS or Dijkstra query from the same start on the same grid version continues the tree of
+// the previous one, so moving only the goal costs nothing for cells that were already settled.
+// Layout orders the search's per-cell planes, it defaults to the one picked at configure time.
+template <typename Grid, typename Layout = CellLayout>
+class BasicSearch {
 public:
-    Search() = default;
-    void Bfs(std::vector<std::vector<Tile>>& grid, Tile* start_ptr, Tile* goal_ptr, bool& gui_busy);
-    void Dijkstra(std::vector<std::vector<Tile>>& grid, Tile* start_ptr, Tile* goal_ptr, bool& gui_busy);
-    void AStar(std::vector<std::vector<Tile>>& grid, Tile* start_ptr, Tile* goal_ptr, bool& gui_busy);
+    BasicSearch() = default;
+    void Begin(Algorithm algorithm, Grid grid, Coordinates start, Coordinates goal);
+    bool IsDone() const {
+        return phase_ == Phase::kDone;
+    }
+    bool IsPathFound() const {
+        return path_found_;
+    }
+    std::size_t NodesExpanded() const {
+        return stats_.nodes_expanded;
+    }
+    const SearchStats& Stats() const {
+        return stats_;
+    }
+    // Everything held for queries: the workspace and the cell counters
+    std::size_t MemoryBytes() const;
+    // Counting costs two 32-bit counters per cell, allocated by every Begin(). Takes effect with the next Begin().
+    void SetCountCells(bool count_cells) {
+        count_cells_ = count_cells;
+    }
+    const CellCounters& Counters() const {
+        return counters_;
+    }
+    // Off leaves the event buffers of Step() and RunFor() empty, for callers that only read the result
+    void SetEmitEvents(bool emit_events) {
+        emit_events_ = emit_events;
+    }
+    // Lets Begin() keep the tree, queue and frontier of the previous query when only the goal changed: a goal
+    // that is already settled gets its path at once, any other one resumes the expansion where it stopped.
+    // Counters then keep adding up over the whole tree. A* starts over, its order depends on the goal.
+    // The grid's Version() has to change with every edit, it is all that tells two grids apart.
+    void SetReuseTree(bool reuse_tree) {
+        reuse_tree_ = reuse_tree;
+    }
+    // Counts Begin() and Step() into stats.perf. The counters belong to the thread that created them,
+    // so only searches running on that thread may use them. nullptr turns counting off again.
+    void SetPerfCounters(PerfCounters* perf_counters) {
+        perf_counters_ = perf_counters;
+    }
+    // Number of moves from start to goal, valid once a path was found
+    std::size_t PathLength() const {
+        return workspace_.Path().size();
+    }
+    // Goal first, the start left out. Valid once a path was found, until the next Begin().
+    const std::vector<Coordinates>& Path() const {
+        return workspace_.Path();
+    }
+    // A step either expands one node or reveals one path tile. Both return the number of steps taken.
+    std::size_t Step(std::size_t n, std::vector<SearchEvent>& events);
+    std::size_t RunFor(std::chrono::microseconds budget, std::size_t max_steps, std::vector<SearchEvent>& events);
+    // Fast path without any suspension, runs the query to the end
+    SearchStats Run(std::vector<SearchEvent>& events);
+    // Begins the query and yields its events one by one. The Search has to outlive the generator,
+    // dropping the generator early simply stops the search.
+    Generator<SearchEvent> Events(Algorithm algorithm, Grid grid, Coordinates start, Coordinates goal);
+    // Runs the search to the end with the GUI animation delays, polling the channel's token every step
+    void Play(SearchChannel& channel);
 
 private:
-    bool InBounds(Coordinates& id, std::vector<std::vector<Tile>>& grid) const;
+    enum class Phase { kIdle, kSearching, kPath, kDone };
+
+    bool InBounds(Coordinates& id) const;
     bool Passable(Coordinates& id) const;
-    std::vector<Coordinates> Neighbors(Coordinates& id, std::vector<std::vector<Tile>>& grid) const;
-    std::string GetVector(Coordinates& current, Coordinates& from);
-    void CollectObstacles(const std::vector<std::vector<Tile>>& grid);
-    void SetPath(std::vector<std::vector<Tile>>& grid, const Tile* start_ptr, Tile* goal_ptr);
+    NeighborList Neighbors(Coordinates& id) const;
+    char GetVector(Direction to_parent);
+    bool CanReuseTree(Algorithm algorithm, const Grid& grid, Coordinates start) const;
+    void ReuseTree(Coordinates goal);
+    bool IsSettled(Coordinates at);
+    bool Emit(SearchChannel& channel, SearchEvent event);
+    void PushEvent(std::vector<SearchEvent>& events, SearchEventType type, Coordinates at, char arrow = 0) const;
+    void ExpandBfs(std::vector<SearchEvent>& events);
+    void ExpandBestFirst(std::vector<SearchEvent>& events);  // Dijkstra and A*
+    void PushFrontier(Coordinates at, double priority);
+    std::pair<Coordinates, double> PopFrontier();  // Lowest priority first
+    void RevealPath(std::vector<SearchEvent>& events);
+    void SetPath();
+    void Finish(std::vector<SearchEvent>& events, bool path_found);
     double Cost(Coordinates& from_node, Coordinates& to_node) const;
     double Heuristic(const Coordinates& a, const Coordinates& b);
+    double Priority(Coordinates at, double cost);
+    void CountCell(std::vector<std::uint32_t>& plane, Coordinates at) {
+        if (count_cells_) {
+            ++plane[counters_.Index(at.x, at.y)];
+        }
+    }
+
+    Algorithm algorithm_ = Algorithm::kBfs;
+    Grid grid_;
+    Coordinates start_{0, 0};
+    Coordinates goal_{0, 0};
+    Phase phase_ = Phase::kIdle;
+    bool path_found_ = false;
+    SearchStats stats_;
+    bool count_cells_ = false;
+    bool emit_events_ = true;
+    bool reuse_tree_ = false;
+    bool goal_popped_ = false;  // The goal left the queue or frontier without getting expanded
+    double settled_cost_ = -1;  // Priority of the last Dijkstra pop, no cell costs less and is still open
+    CellCounters counters_;
+    PerfCounters* perf_counters_ = nullptr;
+
     std::array<Coordinates, 4> delta_{
         Coordinates{1, 0},   // East
         Coordinates{-1, 0},  // West
         Coordinates{0, -1},  // North
         Coordinates{0, 1}    // South
     };
-    std::unordered_set<Coordinates> obstacles_;
-    std::unordered_map<Coordinates, Coordinates> came_from_;
-    std::unordered_map<Coordinates, double> cost_so_far_;
+    BasicSearchWorkspace<Layout> workspace_;  // Shared by all engines, reused from query to query
+    std::size_t path_revealed_ = 0;
+
+    // Lets bench/search_microbench.cpp time the private primitives in isolation
+    friend struct SearchProbe;
 };
+
+// Defined in search.cpp for these grids and layouts only
+extern template class BasicSearch<GridSnapshot, RowMajorLayout>;
+extern template class BasicSearch<GridSnapshot, TiledLayout>;
+extern template class BasicSearch<BitGridView, RowMajorLayout>;
+extern template class BasicSearch<BitGridView, TiledLayout>;
+
+using Search = BasicSearch<GridSnapshot>;
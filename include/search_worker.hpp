@@ -0,0 +1,64 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "search.hpp"
+
+// Long-lived thread that runs one search job after another.
+// Submitting a job aborts everything that is queued or running, so the newest request always wins.
+class SearchWorker {
+public:
+    explicit SearchWorker(SearchEventQueue& events);
+    ~SearchWorker();
+    SearchWorker(const SearchWorker&) = delete;
+    SearchWorker& operator=(const SearchWorker&) = delete;
+
+    // Returns the job id every event of this job will carry. With reuse_tree the job may grow the tree of the
+    // previous one, see BasicSearch::SetReuseTree(); its events then only cover what is new.
+    std::uint32_t Submit(Algorithm algorithm, GridSnapshot grid, Coordinates start, Coordinates goal,
+                         bool reuse_tree = false);
+    void CancelAll();
+    // Copies the statistics, and the per-cell counters if asked for, of a finished job. False while the job
+    // is still running, after it was cancelled, or once a newer job finished.
+    bool LatestStats(std::uint32_t job_id, SearchStats& stats, CellCounters* counters = nullptr);
+    // Progress of the running job, or of the last one once nothing runs
+    std::size_t NodesExpanded() const {
+        return progress_.nodes_expanded.load(std::memory_order_relaxed);
+    }
+    std::size_t MemoryBytes() const {
+        return progress_.memory_bytes.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Job {
+        std::uint32_t id;
+        Algorithm algorithm;
+        GridSnapshot grid;
+        Coordinates start;
+        Coordinates goal;
+        bool reuse_tree;
+        CancelToken token;
+    };
+
+    void Run();
+    void Execute(Job& job, Search& search);
+    void CancelAllLocked();
+
+    SearchEventQueue& events_;  // The worker is its only producer
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Job> jobs_;
+    CancelToken running_token_;
+    std::uint32_t next_job_id_;
+    std::uint32_t finished_job_id_;  // Job that finished_stats_ belong to, 0 if none
+    SearchStats finished_stats_;
+    CellCounters finished_counters_;
+    SearchProgress progress_;
+    bool stop_;
+    std::thread thread_;  // Started last, after everything it uses is initialized
+};
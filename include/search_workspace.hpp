@@ -0,0 +1,198 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "cell_layout.hpp"
+#include "coordinates.hpp"
+
+// Bump allocator for trivially destructible objects. Reset() forgets everything at once and keeps the
+// memory for the next round, so once it has seen its largest round it never allocates again.
+// Blocks come zeroed from calloc(), which maps large ones lazily, so pages that nobody writes are never faulted in.
+class MonotonicArena {
+public:
+    // Uninitialized storage for count objects of T, valid until the next Reset()
+    template <typename T>
+    T* Allocate(std::size_t count) {
+        static_assert(std::is_trivially_destructible_v<T>, "the arena never runs destructors");
+        return static_cast<T*>(AllocateBytes(count * sizeof(T), alignof(T), false));
+    }
+    // Zero-filled storage. Only the part an earlier round handed out gets cleared, fresh memory already is zero.
+    template <typename T>
+    T* AllocateZeroed(std::size_t count) {
+        static_assert(std::is_trivially_destructible_v<T>, "the arena never runs destructors");
+        return static_cast<T*>(AllocateBytes(count * sizeof(T), alignof(T), true));
+    }
+    // O(1) unless the last round needed more than one block or the next one needs more than min_capacity
+    // bytes, then the blocks are replaced by a single one that is large enough
+    void Reset(std::size_t min_capacity = 0);
+    std::size_t Capacity() const {
+        return capacity_;
+    }
+
+private:
+    struct Free {
+        void operator()(std::byte* memory) const {
+            std::free(memory);
+        }
+    };
+    struct Block {
+        std::unique_ptr<std::byte, Free> memory;
+        std::size_t size;
+        std::size_t dirty;  // Bytes from the start that were ever handed out, the rest is still zero
+    };
+    static Block NewBlock(std::size_t size);
+    void* AllocateBytes(std::size_t bytes, std::size_t alignment, bool zeroed);
+
+    std::vector<Block> blocks_;
+    std::size_t used_ = 0;      // Of the last block
+    std::size_t capacity_ = 0;  // All blocks together
+};
+
+// Dense per-index records that all become unset at once. Every record carries the epoch it was written in and
+// only counts while that equals the current one, so Clear() is a single increment; only a wrapped counter makes
+// it touch every slot. T is a trivial struct with a std::uint32_t epoch member, which usually fits into padding
+// that a separate stamp would add. The storage comes from an arena and stays valid until that arena is reset.
+// Zeroed slots hold epoch 0, which is never current, so allocating doesn't write the slots of fresh pages.
+template <typename T>
+class EpochArray {
+public:
+    // Arena bytes that Allocate(arena, size) takes at most
+    static constexpr std::size_t BytesFor(std::size_t size) {
+        return size * sizeof(T) + alignof(T);
+    }
+    // Forgets the old storage, size slots from arena that start out unset
+    void Allocate(MonotonicArena& arena, std::size_t size) {
+        slots_ = arena.AllocateZeroed<T>(size);
+        size_ = size;
+        epoch_ = 1;
+    }
+    void Clear() {
+        if (++epoch_ == 0) {
+            std::fill_n(slots_, size_, T{});
+            epoch_ = 1;
+        }
+    }
+    std::size_t Size() const {
+        return size_;
+    }
+
+    bool IsSet(std::size_t index) const {
+        return slots_[index].epoch == epoch_;
+    }
+    // Only meaningful for set slots
+    const T& Get(std::size_t index) const {
+        return slots_[index];
+    }
+    void Set(std::size_t index, T record) {
+        record.epoch = epoch_;
+        slots_[index] = record;
+    }
+
+private:
+    T* slots_ = nullptr;
+    std::size_t size_ = 0;
+    std::uint32_t epoch_ = 1;  // Slots start out at 0, which is never current
+};
+
+// All per-query memory of a search, in an arena sized for the largest grid so far: which cells were reached,
+// the direction back to each one's parent in 2 bits, and either the BFS queue or the costs of the best-first
+// engines. The frontier and the path are pooled vectors that keep their capacity.
+// Reached cells are an EpochArray, so starting a query is O(1) and back-to-back queries on grids no larger
+// than before allocate nothing. The parents and costs need no clearing, they are only read for reached cells.
+// Layout orders the cells of every plane, see cell_layout.hpp.
+template <typename Layout>
+class BasicSearchWorkspace {
+public:
+    // Starts a query on a width x height grid. A BFS gets the queue but no costs, the other engines the costs.
+    void Begin(int width, int height, bool bfs);
+
+    bool IsReached(Coordinates at) const {
+        return reached_.IsSet(Index(at));
+    }
+    // Only valid for reached cells other than the start
+    Direction ParentDirection(Coordinates at) const {
+        const std::size_t index = Index(at);
+        return static_cast<Direction>((parents_[index / 4] >> (index % 4 * 2)) & 3u);
+    }
+    Coordinates Parent(Coordinates at) const {
+        return Neighbor(at, ParentDirection(at));
+    }
+    // Only valid for reached cells of a best-first query
+    double Cost(Coordinates at) const {
+        return costs_[Index(at)];
+    }
+    // The BFS doesn't keep costs
+    void Reach(Coordinates at, Direction to_parent) {
+        const std::size_t index = Index(at);
+        reached_.Set(index, Visit{});
+        const unsigned shift = index % 4 * 2;
+        std::uint8_t& packed = parents_[index / 4];
+        packed = static_cast<std::uint8_t>((packed & ~(3u << shift)) | static_cast<unsigned>(to_parent) << shift);
+    }
+    void Reach(Coordinates at, Direction to_parent, double cost) {
+        Reach(at, to_parent);
+        costs_[Index(at)] = cost;
+    }
+
+    // FIFO of the BFS, every cell enters it at most once
+    void PushQueue(Coordinates at) {
+        queue_[queue_tail_++] = static_cast<std::uint32_t>(Index(at));
+    }
+    Coordinates PopQueue() {
+        return layout_.At(queue_[queue_head_++]);
+    }
+    // Puts the cell popped last back at the front
+    void UnpopQueue() {
+        --queue_head_;
+    }
+    bool IsQueueEmpty() const {
+        return queue_head_ == queue_tail_;
+    }
+    std::size_t QueueSize() const {
+        return queue_tail_ - queue_head_;
+    }
+
+    std::vector<std::pair<Coordinates, double>>& Frontier() {
+        return frontier_;
+    }
+    std::vector<Coordinates>& Path() {
+        return path_;
+    }
+    const std::vector<Coordinates>& Path() const {
+        return path_;
+    }
+
+    std::size_t MemoryBytes() const;
+
+private:
+    struct Visit {
+        std::uint32_t epoch;
+    };
+
+    std::size_t Index(Coordinates at) const {
+        return layout_.Index(at);
+    }
+
+    MonotonicArena arena_;
+    EpochArray<Visit> reached_;
+    std::uint8_t* parents_ = nullptr;  // Four Directions per byte, the lowest bits first
+    double* costs_ = nullptr;          // nullptr until a best-first query needed them
+    std::uint32_t* queue_ = nullptr;   // nullptr until a BFS needed it
+    std::size_t queue_head_ = 0, queue_tail_ = 0;
+    Layout layout_;
+    std::vector<std::pair<Coordinates, double>> frontier_;
+    std::vector<Coordinates> path_;  // Goal first
+};
+
+// Defined in search_workspace.cpp for these layouts only
+extern template class BasicSearchWorkspace<RowMajorLayout>;
+extern template class BasicSearchWorkspace<TiledLayout>;
+
+using SearchWorkspace = BasicSearchWorkspace<CellLayout>;
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Lock-free ring buffer for exactly one producer thread and one consumer thread.
+// One slot always stays free to tell a full buffer from an empty one.
+template <typename T, std::size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    // Producer side
+    bool TryPush(const T& item) {
+        const std::size_t head = head_.load(std::memory_order_relaxed);
+        const std::size_t next = (head + 1) & kMask;
+        if (next == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        buffer_[head] = item;
+        head_.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side
+    bool TryPop(T& item) {
+        const std::size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = buffer_[tail];
+        tail_.store((tail + 1) & kMask, std::memory_order_release);
+        return true;
+    }
+
+    // Only a snapshot, the other side may change it any time
+    std::size_t SizeApprox() const {
+        const std::size_t head = head_.load(std::memory_order_acquire);
+        const std::size_t tail = tail_.load(std::memory_order_acquire);
+        return (head - tail) & kMask;
+    }
+
+    static constexpr std::size_t MaxSize() {
+        return Capacity - 1;
+    }
+
+private:
+    static constexpr std::size_t kMask = Capacity - 1;
+
+    // Keep the indices on separate cache lines so producer and consumer don't false share
+    alignas(64) std::atomic<std::size_t> head_{0};
+    alignas(64) std::atomic<std::size_t> tail_{0};
+    std::array<T, Capacity> buffer_;
+};
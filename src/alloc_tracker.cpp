@@ -0,0 +1,49 @@
+#include "alloc_tracker.hpp"
+
+#ifdef PATHFINDING_ALLOC_TRACKING
+#include <cstdlib>
+#include <new>
+#endif
+
+namespace {
+
+// Constant-initialized, so touching it from operator new never runs a TLS constructor
+thread_local AllocCounts t_counts;
+
+}  // namespace
+
+AllocCounts ThreadAllocCounts() {
+    return t_counts;
+}
+
+#ifdef PATHFINDING_ALLOC_TRACKING
+// The array, nothrow and sized forms of the standard library forward to these four
+
+void* operator new(std::size_t size) {
+    ++t_counts.allocations;
+    t_counts.bytes += size;
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    ++t_counts.allocations;
+    t_counts.bytes += size;
+    const auto align = static_cast<std::size_t>(alignment);
+    // aligned_alloc wants a multiple of the alignment
+    if (void* p = std::aligned_alloc(align, (size + align - 1) / align * align + (size == 0 ? align : 0))) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    std::free(p);
+}
+#endif
@@ -0,0 +1,351 @@
+#include "components.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <thread>
+
+#include "parallel_for.hpp"
+
+namespace {
+
+constexpr int kBandRows = 64;  // Rows labelled by one task of Build()
+
+// Root of a cell with path halving, links always point to a smaller index
+std::uint32_t FindRoot(std::vector<std::uint32_t>& parents, std::uint32_t x) {
+    while (parents[x] != x) {
+        parents[x] = parents[parents[x]];
+        x = parents[x];
+    }
+    return x;
+}
+
+// The smaller root wins, which keeps the labels of Build() independent of the thread count
+void Unite(std::vector<std::uint32_t>& parents, std::uint32_t a, std::uint32_t b) {
+    a = FindRoot(parents, a);
+    b = FindRoot(parents, b);
+    if (a < b) {
+        parents[b] = a;
+    } else if (b < a) {
+        parents[a] = b;
+    }
+}
+
+}  // namespace
+
+template <typename Grid>
+void ComponentIndex::Build(const Grid& grid) {
+    width_ = grid.Width();
+    height_ = grid.Height();
+    const std::size_t cells = static_cast<std::size_t>(width_) * height_;
+    labels_.assign(cells, kNoComponent);
+    parents_.resize(cells);
+    const unsigned workers = cells < kParallelLabelCells ? 1 : std::max(1u, std::thread::hardware_concurrency());
+    const std::size_t bands = (height_ + kBandRows - 1) / kBandRows;
+
+    // Union-find over cell indices. Each band unites only its own cells, so the bands don't share any writes.
+    ParallelFor(bands, workers, [&](std::size_t band) {
+        const int first_row = static_cast<int>(band) * kBandRows;
+        const int end_row = std::min(height_, first_row + kBandRows);
+        for (int y = first_row; y < end_row; ++y) {
+            for (int x = 0; x < width_; ++x) {
+                if (grid.IsObstacle(x, y)) {
+                    continue;
+                }
+                const auto index = static_cast<std::uint32_t>(Index(x, y));
+                labels_[index] = index;
+                parents_[index] = index;
+                if (x > 0 && labels_[index - 1] != kNoComponent) {
+                    Unite(parents_, index - 1, index);
+                }
+                if (y > first_row && labels_[index - width_] != kNoComponent) {
+                    Unite(parents_, index - static_cast<std::uint32_t>(width_), index);
+                }
+            }
+        }
+    });
+    // Stitch the bands together along their first rows
+    for (std::size_t band = 1; band < bands; ++band) {
+        const int y = static_cast<int>(band) * kBandRows;
+        for (int x = 0; x < width_; ++x) {
+            const auto index = static_cast<std::uint32_t>(Index(x, y));
+            if (labels_[index] != kNoComponent && labels_[index - width_] != kNoComponent) {
+                Unite(parents_, index - static_cast<std::uint32_t>(width_), index);
+            }
+        }
+    }
+    // Every cell takes its root as label, reading the finished forest only
+    std::vector<std::size_t> roots(bands, 0);
+    ParallelFor(bands, workers, [&](std::size_t band) {
+        const std::size_t begin = band * kBandRows * static_cast<std::size_t>(width_);
+        const std::size_t end = std::min(cells, begin + kBandRows * static_cast<std::size_t>(width_));
+        for (std::size_t index = begin; index < end; ++index) {
+            if (labels_[index] == kNoComponent) {
+                continue;
+            }
+            std::uint32_t root = static_cast<std::uint32_t>(index);
+            while (parents_[root] != root) {
+                root = parents_[root];
+            }
+            labels_[index] = root;
+            roots[band] += root == index;
+        }
+    });
+    component_count_ = 0;
+    for (std::size_t count : roots) {
+        component_count_ += count;
+    }
+    last_update_cells_ = cells;
+}
+
+template <typename Grid>
+bool ComponentIndex::Assign(const Grid& grid, const std::vector<std::uint32_t>& labels) {
+    const int width = grid.Width();
+    const int height = grid.Height();
+    const std::size_t cells = static_cast<std::size_t>(width) * height;
+    if (labels.size() != cells) {
+        return false;
+    }
+    std::size_t roots = 0;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const std::size_t index = static_cast<std::size_t>(y) * width + x;
+            const std::uint32_t label = labels[index];
+            if (grid.IsObstacle(x, y)) {
+                if (label != kNoComponent) {
+                    return false;
+                }
+                continue;
+            }
+            if (label > index || labels[label] != label) {
+                return false;
+            }
+            if ((x > 0 && labels[index - 1] != kNoComponent && labels[index - 1] != label) ||
+                (y > 0 && labels[index - width] != kNoComponent && labels[index - width] != label)) {
+                return false;
+            }
+            roots += label == index;
+        }
+    }
+    width_ = width;
+    height_ = height;
+    labels_ = labels;
+    parents_.resize(cells);
+    std::iota(parents_.begin(), parents_.end(), 0u);
+    component_count_ = roots;
+    last_update_cells_ = cells;
+    return true;
+}
+
+std::vector<std::uint32_t> ComponentIndex::Labels() {
+    // Roots are numbered by the first cell reaching them, which for Build() labels is the root itself
+    std::vector<std::uint32_t> names(parents_.size(), kNoComponent);
+    std::vector<std::uint32_t> labels(labels_.size(), kNoComponent);
+    for (std::size_t index = 0; index < labels_.size(); ++index) {
+        if (labels_[index] == kNoComponent) {
+            continue;
+        }
+        std::uint32_t& name = names[Find(labels_[index])];
+        if (name == kNoComponent) {
+            name = static_cast<std::uint32_t>(index);
+        }
+        labels[index] = name;
+    }
+    return labels;
+}
+
+void ComponentIndex::SetObstacle(int x, int y, bool obstacle) {
+    const std::size_t index = Index(x, y);
+    if ((labels_[index] == kNoComponent) == obstacle) {
+        return;
+    }
+    last_update_cells_ = 1;
+    std::array<std::uint32_t, 4> neighbors;
+    const int count = FreeNeighbors(index, neighbors);
+    if (!obstacle && count == 0) {
+        labels_[index] = NewLabel();
+        ++component_count_;
+    } else if (!obstacle) {
+        // The new cell joins every component around it
+        const std::uint32_t root = Find(labels_[neighbors[0]]);
+        for (int i = 1; i < count; ++i) {
+            const std::uint32_t other = Find(labels_[neighbors[i]]);
+            if (other != root) {
+                parents_[other] = root;
+                --component_count_;
+            }
+        }
+        labels_[index] = root;
+    } else {
+        labels_[index] = kNoComponent;
+        if (count == 0) {
+            --component_count_;
+        } else if (count > 1) {
+            Split(neighbors, count);
+        }
+    }
+    // Once new labels outnumber the cells, most of parents_ is dead. An edit adds at most three labels, so the
+    // O(cells) renumbering comes after at least cells / 3 edits and parents_ stays within twice the cell count.
+    if (parents_.size() > 2 * labels_.size()) {
+        Compact();
+    }
+}
+
+void ComponentIndex::Compact() {
+    labels_ = Labels();
+    parents_.resize(labels_.size());
+    std::iota(parents_.begin(), parents_.end(), 0u);
+    last_update_cells_ += labels_.size();
+}
+
+void ComponentIndex::Split(const std::array<std::uint32_t, 4>& neighbors, int count) {
+    const std::size_t cells = labels_.size();
+    if (marks_.Size() < cells) {
+        arena_.Reset(EpochArray<Mark>::BytesFor(cells));
+        marks_.Allocate(arena_, cells);
+    } else {
+        marks_.Clear();
+    }
+    // Floods that met are merged into one group, a tiny union-find over at most four floods
+    std::array<std::uint8_t, 4> group{0, 1, 2, 3};
+    auto group_of = [&group](std::uint8_t flood) {
+        while (group[flood] != flood) {
+            flood = group[flood];
+        }
+        return flood;
+    };
+    std::array<std::size_t, 4> heads{};
+    for (int f = 0; f < count; ++f) {
+        floods_[f].clear();
+        floods_[f].push_back(neighbors[f]);
+        marks_.Set(neighbors[f], Mark{0, static_cast<std::uint8_t>(f)});
+    }
+    auto is_growing = [&](std::uint8_t root) {
+        for (int f = 0; f < count; ++f) {
+            if (group_of(static_cast<std::uint8_t>(f)) == root && heads[f] < floods_[f].size()) {
+                return true;
+            }
+        }
+        return false;
+    };
+    auto growing_groups = [&] {
+        int growing = 0;
+        for (int f = 0; f < count; ++f) {
+            growing += group_of(static_cast<std::uint8_t>(f)) == f && is_growing(static_cast<std::uint8_t>(f));
+        }
+        return growing;
+    };
+
+    // One cell per flood and round, until at most one group can still be the rest of the old component
+    while (growing_groups() > 1) {
+        for (int f = 0; f < count; ++f) {
+            if (heads[f] == floods_[f].size()) {
+                continue;
+            }
+            const std::uint32_t cell = floods_[f][heads[f]++];
+            std::array<std::uint32_t, 4> next;
+            const int next_count = FreeNeighbors(cell, next);
+            for (int n = 0; n < next_count; ++n) {
+                if (!marks_.IsSet(next[n])) {
+                    marks_.Set(next[n], Mark{0, static_cast<std::uint8_t>(f)});
+                    floods_[f].push_back(next[n]);
+                    continue;
+                }
+                const std::uint8_t mine = group_of(static_cast<std::uint8_t>(f));
+                const std::uint8_t theirs = group_of(marks_.Get(next[n]).flood);
+                if (mine != theirs) {
+                    group[std::max(mine, theirs)] = std::min(mine, theirs);
+                }
+            }
+        }
+    }
+
+    // Groups that stopped growing are cut off and get labels of their own. The one still growing, or the first
+    // if none is, keeps the old label.
+    int keeper = -1;
+    for (int f = 0; f < count && keeper == -1; ++f) {
+        if (group_of(static_cast<std::uint8_t>(f)) == f && is_growing(static_cast<std::uint8_t>(f))) {
+            keeper = f;
+        }
+    }
+    if (keeper == -1) {
+        keeper = 0;
+    }
+    last_update_cells_ = 0;
+    for (int root = 0; root < count; ++root) {
+        if (group_of(static_cast<std::uint8_t>(root)) != root || root == keeper) {
+            continue;
+        }
+        const std::uint32_t label = NewLabel();
+        ++component_count_;
+        for (int f = 0; f < count; ++f) {
+            if (group_of(static_cast<std::uint8_t>(f)) == root) {
+                for (std::uint32_t cell : floods_[f]) {
+                    labels_[cell] = label;
+                }
+            }
+        }
+    }
+    for (int f = 0; f < count; ++f) {
+        last_update_cells_ += floods_[f].size();
+    }
+}
+
+int ComponentIndex::FreeNeighbors(std::size_t index, std::array<std::uint32_t, 4>& neighbors) const {
+    const int x = static_cast<int>(index % width_);
+    const int y = static_cast<int>(index / width_);
+    int count = 0;
+    auto add = [&](std::size_t neighbor) {
+        if (labels_[neighbor] != kNoComponent) {
+            neighbors[count++] = static_cast<std::uint32_t>(neighbor);
+        }
+    };
+    if (x + 1 < width_) {
+        add(index + 1);
+    }
+    if (x > 0) {
+        add(index - 1);
+    }
+    if (y > 0) {
+        add(index - width_);
+    }
+    if (y + 1 < height_) {
+        add(index + width_);
+    }
+    return count;
+}
+
+std::uint32_t ComponentIndex::Find(std::uint32_t label) {
+    return FindRoot(parents_, label);
+}
+
+std::uint32_t ComponentIndex::NewLabel() {
+    // Labels from Build() are cell indices, later ones follow behind them
+    const auto label = static_cast<std::uint32_t>(parents_.size());
+    parents_.push_back(label);
+    return label;
+}
+
+bool ComponentIndex::IsConnected(Coordinates a, Coordinates b) {
+    const std::uint32_t component = Component(a);
+    return component != kNoComponent && component == Component(b);
+}
+
+std::uint32_t ComponentIndex::Component(Coordinates at) {
+    const std::uint32_t label = labels_[Index(at.x, at.y)];
+    return label == kNoComponent ? kNoComponent : Find(label);
+}
+
+std::size_t ComponentIndex::MemoryBytes() const {
+    std::size_t bytes = (labels_.capacity() + parents_.capacity()) * sizeof(std::uint32_t) + arena_.Capacity();
+    for (const auto& flood : floods_) {
+        bytes += flood.capacity() * sizeof(std::uint32_t);
+    }
+    return bytes;
+}
+
+template void ComponentIndex::Build<OccupancyGrid>(const OccupancyGrid& grid);
+template void ComponentIndex::Build<GridSnapshot>(const GridSnapshot& grid);
+template void ComponentIndex::Build<BitGridView>(const BitGridView& grid);
+template bool ComponentIndex::Assign<OccupancyGrid>(const OccupancyGrid& grid, const std::vector<std::uint32_t>& labels);
+template bool ComponentIndex::Assign<GridSnapshot>(const GridSnapshot& grid, const std::vector<std::uint32_t>& labels);
+template bool ComponentIndex::Assign<BitGridView>(const BitGridView& grid, const std::vector<std::uint32_t>& labels);
@@ -0,0 +1,254 @@
+#include "editor_state.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+constexpr char kMagic[8] = {'S', 'P', 'M', 'A', 'P', '\0', '\0', '\0'};
+constexpr std::uint32_t kFormatVersion = 1;
+
+class Writer {
+public:
+    void U32(std::uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            bytes_.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+        }
+    }
+    void I32(std::int32_t value) {
+        U32(static_cast<std::uint32_t>(value));
+    }
+    // LEB128, small runs take a single byte
+    void Varint(std::uint64_t value) {
+        while (value >= 0x80) {
+            bytes_.push_back(static_cast<std::uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        bytes_.push_back(static_cast<std::uint8_t>(value));
+    }
+    void Bytes(const void* data, std::size_t size) {
+        const auto* p = static_cast<const std::uint8_t*>(data);
+        bytes_.insert(bytes_.end(), p, p + size);
+    }
+    const std::vector<std::uint8_t>& Data() const {
+        return bytes_;
+    }
+
+private:
+    std::vector<std::uint8_t> bytes_;
+};
+
+class Reader {
+public:
+    Reader(const std::vector<std::uint8_t>& bytes, const std::string& path) : bytes_(bytes), path_(path) {}
+
+    std::uint32_t U32() {
+        Need(4);
+        std::uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) {
+            value |= static_cast<std::uint32_t>(bytes_[pos_++]) << (8 * i);
+        }
+        return value;
+    }
+    std::int32_t I32() {
+        return static_cast<std::int32_t>(U32());
+    }
+    std::uint64_t Varint() {
+        std::uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            Need(1);
+            const std::uint8_t byte = bytes_[pos_++];
+            value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+        Fail("varint too long");
+    }
+    void Bytes(void* data, std::size_t size) {
+        Need(size);
+        std::memcpy(data, bytes_.data() + pos_, size);
+        pos_ += size;
+    }
+    std::size_t Remaining() const {
+        return bytes_.size() - pos_;
+    }
+    [[noreturn]] void Fail(const std::string& what) const {
+        throw std::runtime_error(path_ + ": " + what);
+    }
+
+private:
+    void Need(std::size_t size) const {
+        if (bytes_.size() - pos_ < size) {
+            Fail("unexpected end of file");
+        }
+    }
+
+    const std::vector<std::uint8_t>& bytes_;
+    const std::string& path_;
+    std::size_t pos_ = 0;
+};
+
+bool InGrid(const Coordinates& c, int width, int height) {
+    return 0 <= c.x && c.x < width && 0 <= c.y && c.y < height;
+}
+
+}  // namespace
+
+void SaveEditorState(const std::string& path, const EditorState& state) {
+    if (state.obstacles.size() != static_cast<std::size_t>(state.width) * state.height) {
+        throw std::runtime_error("editor state doesn't match its size");
+    }
+    Writer out;
+    out.Bytes(kMagic, sizeof(kMagic));
+    out.U32(kFormatVersion);
+    out.U32(static_cast<std::uint32_t>(state.width));
+    out.U32(static_cast<std::uint32_t>(state.height));
+    out.I32(state.start.x);
+    out.I32(state.start.y);
+    out.I32(state.goal.x);
+    out.I32(state.goal.y);
+    out.U32(static_cast<std::uint32_t>(state.algorithm));
+    out.U32(static_cast<std::uint32_t>(state.indices.size()));
+
+    std::vector<std::uint64_t> runs;
+    std::uint8_t current = 0;  // Runs start with free cells
+    std::uint64_t length = 0;
+    for (std::uint8_t cell : state.obstacles) {
+        const std::uint8_t value = cell != 0 ? 1 : 0;
+        if (value != current) {
+            runs.push_back(length);
+            current = value;
+            length = 0;
+        }
+        ++length;
+    }
+    runs.push_back(length);
+    out.Varint(runs.size());
+    for (std::uint64_t run : runs) {
+        out.Varint(run);
+    }
+
+    for (const auto& index : state.indices) {
+        out.U32(index.tag);
+        out.Varint(index.data.size());
+        out.Bytes(index.data.data(), index.data.size());
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(out.Data().data()), static_cast<std::streamsize>(out.Data().size()));
+    if (!file) {
+        throw std::runtime_error("can't write " + path);
+    }
+}
+
+EditorState LoadEditorState(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("can't open " + path);
+    }
+    const std::vector<std::uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    Reader in(bytes, path);
+
+    char magic[sizeof(kMagic)];
+    in.Bytes(magic, sizeof(magic));
+    if (std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) {
+        in.Fail("not an editor state file");
+    }
+    if (in.U32() != kFormatVersion) {
+        in.Fail("unsupported format version");
+    }
+
+    EditorState state;
+    state.width = static_cast<int>(in.U32());
+    state.height = static_cast<int>(in.U32());
+    state.start = Coordinates{in.I32(), in.I32()};
+    state.goal = Coordinates{in.I32(), in.I32()};
+    const std::uint32_t algorithm = in.U32();
+    const std::uint32_t index_count = in.U32();
+    if (state.width <= 0 || state.height <= 0 || state.width > kMaxEditorStateSide ||
+        state.height > kMaxEditorStateSide ||
+        static_cast<std::size_t>(state.width) * state.height > kMaxEditorStateCells ||
+        !InGrid(state.start, state.width, state.height) ||
+        !InGrid(state.goal, state.width, state.height) || algorithm >= kAllAlgorithms.size()) {
+        in.Fail("invalid header");
+    }
+    state.algorithm = static_cast<Algorithm>(algorithm);
+
+    const std::size_t cells = static_cast<std::size_t>(state.width) * state.height;
+    const std::uint64_t run_count = in.Varint();
+    // Every run takes at least one byte
+    if (run_count > in.Remaining()) {
+        in.Fail("more obstacle runs than the file holds");
+    }
+    state.obstacles.reserve(cells);
+    std::uint8_t value = 0;
+    for (std::uint64_t i = 0; i < run_count; ++i, value ^= 1) {
+        const std::uint64_t run = in.Varint();
+        if (run > cells - state.obstacles.size()) {
+            in.Fail("obstacle runs exceed the grid");
+        }
+        state.obstacles.insert(state.obstacles.end(), run, value);
+    }
+    if (state.obstacles.size() != cells) {
+        in.Fail("obstacle runs don't cover the grid");
+    }
+
+    for (std::uint32_t i = 0; i < index_count; ++i) {
+        EditorIndex index;
+        index.tag = in.U32();
+        const std::uint64_t size = in.Varint();
+        if (size > in.Remaining()) {
+            in.Fail("index larger than the file");
+        }
+        index.data.resize(static_cast<std::size_t>(size));
+        in.Bytes(index.data.data(), index.data.size());
+        state.indices.push_back(std::move(index));
+    }
+    return state;
+}
+
+const EditorIndex* FindEditorIndex(const EditorState& state, std::uint32_t tag) {
+    for (const auto& index : state.indices) {
+        if (index.tag == tag) {
+            return &index;
+        }
+    }
+    return nullptr;
+}
+
+EditorIndex EncodeLabelIndex(std::uint32_t tag, const std::vector<std::uint32_t>& labels) {
+    Writer out;
+    for (std::size_t begin = 0; begin < labels.size();) {
+        std::size_t end = begin + 1;
+        while (end < labels.size() && labels[end] == labels[begin]) {
+            ++end;
+        }
+        out.Varint(end - begin);
+        out.Varint(labels[begin]);
+        begin = end;
+    }
+    return EditorIndex{tag, out.Data()};
+}
+
+bool DecodeLabelIndex(const EditorIndex& index, std::size_t cells, std::vector<std::uint32_t>& labels) {
+    const std::string name = "index " + std::to_string(index.tag);
+    Reader in(index.data, name);
+    labels.clear();
+    try {
+        while (in.Remaining() > 0) {
+            const std::uint64_t run = in.Varint();
+            const std::uint64_t label = in.Varint();
+            if (run == 0 || run > cells - labels.size() || label > UINT32_MAX) {
+                return false;
+            }
+            labels.insert(labels.end(), static_cast<std::size_t>(run), static_cast<std::uint32_t>(label));
+        }
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+    return labels.size() == cells;
+}
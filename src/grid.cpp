@@ -0,0 +1,90 @@
+#include "grid.hpp"
+
+#include <algorithm>
+
+OccupancyGrid::OccupancyGrid(int width, int height)
+    : width_(width),
+      height_(height),
+      chunks_x_((width + kChunkSide - 1) / kChunkSide),
+      version_(0),
+      snapshot_epoch_(1),
+      table_epoch_(0),
+      chunk_epochs_() {
+    Clear();
+    version_ = 0;
+}
+
+bool OccupancyGrid::IsObstacle(int x, int y) const {
+    return (*table_)[ChunkIndex(x, y)]->cells[CellIndex(x, y)] != 0;
+}
+
+void OccupancyGrid::SetObstacle(int x, int y, bool obstacle) {
+    if (IsObstacle(x, y) == obstacle) {
+        return;
+    }
+    MutableChunk(ChunkIndex(x, y)).cells[CellIndex(x, y)] = obstacle ? 1 : 0;
+    ++version_;
+}
+
+void OccupancyGrid::Clear() {
+    const int chunks_y = (height_ + kChunkSide - 1) / kChunkSide;
+    // All chunks point to the same empty one until they get written.
+    // The fresh table itself is private right away.
+    const auto empty = std::make_shared<Chunk>();
+    table_ = std::make_shared<ChunkTable>(static_cast<std::size_t>(chunks_x_) * chunks_y, empty);
+    table_epoch_ = snapshot_epoch_;
+    chunk_epochs_.assign(table_->size(), 0);
+    ++version_;
+}
+
+void OccupancyGrid::Assign(const BitGridView& bits) {
+    static_assert(64 % kChunkSide == 0, "A chunk row must not straddle two words");
+    const int chunks_y = (height_ + kChunkSide - 1) / kChunkSide;
+    for (int chunk_y = 0; chunk_y < chunks_y; ++chunk_y) {
+        for (int chunk_x = 0; chunk_x < chunks_x_; ++chunk_x) {
+            Chunk& chunk = MutableChunk(chunk_y * chunks_x_ + chunk_x);
+            const int x0 = chunk_x * kChunkSide;
+            const int columns = std::min(kChunkSide, width_ - x0);
+            const std::uint64_t mask = (std::uint64_t{1} << columns) - 1;
+            for (int row = 0; row < kChunkSide; ++row) {
+                const int y = chunk_y * kChunkSide + row;
+                const std::uint64_t cells = y < height_ ? (bits.Row(y)[x0 / 64] >> (x0 % 64)) & mask : 0;
+                for (int i = 0; i < kChunkSide; ++i) {
+                    chunk.cells[row * kChunkSide + i] = (cells >> i) & 1u;
+                }
+            }
+        }
+    }
+    ++version_;
+}
+
+GridSnapshot OccupancyGrid::Snapshot() {
+    ++snapshot_epoch_;
+    return GridSnapshot(table_, width_, height_, chunks_x_, version_);
+}
+
+std::size_t OccupancyGrid::MemoryBytes() const {
+    // Untouched chunks all share the empty one, count every chunk once
+    std::vector<const Chunk*> chunks;
+    chunks.reserve(table_->size());
+    for (const auto& chunk : *table_) {
+        chunks.push_back(chunk.get());
+    }
+    std::sort(chunks.begin(), chunks.end());
+    const std::size_t distinct = std::unique(chunks.begin(), chunks.end()) - chunks.begin();
+    return table_->capacity() * sizeof(ChunkTable::value_type) + distinct * sizeof(Chunk) +
+           chunk_epochs_.capacity() * sizeof(std::uint64_t);
+}
+
+OccupancyGrid::Chunk& OccupancyGrid::MutableChunk(int chunk_index) {
+    if (table_epoch_ != snapshot_epoch_) {
+        table_ = std::make_shared<ChunkTable>(*table_);
+        table_epoch_ = snapshot_epoch_;
+    }
+    auto& chunk = (*table_)[chunk_index];
+    if (chunk_epochs_[chunk_index] != snapshot_epoch_) {
+        chunk = std::make_shared<Chunk>(*chunk);
+        chunk_epochs_[chunk_index] = snapshot_epoch_;
+    }
+    return *chunk;
+}
@@ -0,0 +1,224 @@
+#include "grid_file.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SP_HAVE_MMAP 1
+#endif
+
+namespace {
+
+std::uint64_t AlignUp(std::uint64_t value, std::uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Converts between host and little-endian byte order, both ways are the same swap
+template <typename T>
+T LittleEndian(T value) {
+    if constexpr (std::endian::native == std::endian::big) {
+        auto bytes = std::bit_cast<std::array<std::uint8_t, sizeof(T)>>(value);
+        std::reverse(bytes.begin(), bytes.end());
+        value = std::bit_cast<T>(bytes);
+    }
+    return value;
+}
+
+void SwapHeader(GridFileHeader& header) {
+    header.format_version = LittleEndian(header.format_version);
+    header.flags = LittleEndian(header.flags);
+    header.width = LittleEndian(header.width);
+    header.height = LittleEndian(header.height);
+    header.occupancy_offset = LittleEndian(header.occupancy_offset);
+    header.occupancy_stride_words = LittleEndian(header.occupancy_stride_words);
+    header.cost_offset = LittleEndian(header.cost_offset);
+    header.cost_stride_bytes = LittleEndian(header.cost_stride_bytes);
+}
+
+// False if a * b or a + b doesn't fit 64 bits
+bool CheckedMul(std::uint64_t a, std::uint64_t b, std::uint64_t& result) {
+    if (a != 0 && b > UINT64_MAX / a) {
+        return false;
+    }
+    result = a * b;
+    return true;
+}
+bool CheckedAdd(std::uint64_t a, std::uint64_t b, std::uint64_t& result) {
+    if (b > UINT64_MAX - a) {
+        return false;
+    }
+    result = a + b;
+    return true;
+}
+
+// A plane of stride bytes per row that starts at a page-aligned offset and ends within the file
+bool IsPlaneInFile(std::uint64_t offset, std::uint64_t stride, std::uint64_t height, std::uint64_t file_size) {
+    std::uint64_t size = 0, end = 0;
+    return offset % kGridFilePageSize == 0 && CheckedMul(stride, height, size) && CheckedAdd(offset, size, end) &&
+           end <= file_size;
+}
+
+void PadTo(std::ofstream& file, std::uint64_t offset) {
+    static const char kZeros[kGridFilePageSize] = {};
+    auto position = static_cast<std::uint64_t>(file.tellp());
+    while (position < offset) {
+        const auto n = std::min<std::uint64_t>(offset - position, sizeof(kZeros));
+        file.write(kZeros, static_cast<std::streamsize>(n));
+        position += n;
+    }
+}
+
+}  // namespace
+
+void WriteGridFile(const std::string& path, const GridSnapshot& grid, const std::vector<std::uint8_t>& costs) {
+    const auto width = static_cast<std::uint64_t>(grid.Width());
+    const auto height = static_cast<std::uint64_t>(grid.Height());
+    if (!costs.empty() && costs.size() != width * height) {
+        throw std::runtime_error("cost plane doesn't match the grid size");
+    }
+
+    GridFileHeader header{};
+    std::memcpy(header.magic, kGridFileMagic, sizeof(header.magic));
+    header.format_version = kGridFileVersion;
+    header.flags = costs.empty() ? 0 : kGridFileHasCosts;
+    header.width = static_cast<std::uint32_t>(width);
+    header.height = static_cast<std::uint32_t>(height);
+    header.occupancy_offset = kGridFilePageSize;
+    header.occupancy_stride_words = (width + 63) / 64;
+    const std::uint64_t occupancy_end = header.occupancy_offset + header.occupancy_stride_words * 8 * height;
+    if (!costs.empty()) {
+        header.cost_offset = AlignUp(occupancy_end, kGridFilePageSize);
+        header.cost_stride_bytes = AlignUp(width, 64);
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("can't create " + path);
+    }
+    GridFileHeader stored = header;
+    SwapHeader(stored);
+    file.write(reinterpret_cast<const char*>(&stored), sizeof(stored));
+    PadTo(file, header.occupancy_offset);
+
+    std::vector<std::uint64_t> row(header.occupancy_stride_words);
+    for (int y = 0; y < grid.Height(); ++y) {
+        std::fill(row.begin(), row.end(), 0);
+        for (int x = 0; x < grid.Width(); ++x) {
+            if (grid.IsObstacle(x, y)) {
+                row[x / 64] |= std::uint64_t{1} << (x % 64);
+            }
+        }
+        for (std::uint64_t& word : row) {
+            word = LittleEndian(word);
+        }
+        file.write(reinterpret_cast<const char*>(row.data()), static_cast<std::streamsize>(row.size() * 8));
+    }
+
+    if (!costs.empty()) {
+        PadTo(file, header.cost_offset);
+        std::vector<char> padding(header.cost_stride_bytes - width, 0);
+        for (std::uint64_t y = 0; y < height; ++y) {
+            file.write(reinterpret_cast<const char*>(costs.data() + y * width), static_cast<std::streamsize>(width));
+            file.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+        }
+    }
+    if (!file) {
+        throw std::runtime_error("can't write " + path);
+    }
+}
+
+MappedGrid::MappedGrid(const std::string& path) {
+#ifdef SP_HAVE_MMAP
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("can't open " + path);
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(GridFileHeader)) {
+        ::close(fd);
+        throw std::runtime_error(path + " is too small for a grid file");
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+    void* data = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);  // The mapping keeps the file alive
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("can't map " + path);
+    }
+    mapping_ = data;
+    data_ = static_cast<const std::uint8_t*>(data);
+    std::memcpy(&header_, data_, sizeof(header_));
+    SwapHeader(header_);
+#else
+    throw std::runtime_error("memory-mapped grid files need a POSIX system: " + path);
+#endif
+    if constexpr (std::endian::native != std::endian::little) {
+        Unmap();
+        throw std::runtime_error("mapping " + path + " needs a little-endian host");
+    }
+
+    // Every size comes from the file, so none of the arithmetic may overflow
+    const GridFileHeader& h = header_;
+    const bool valid = std::memcmp(h.magic, kGridFileMagic, sizeof(h.magic)) == 0 && h.format_version == kGridFileVersion &&
+                       h.width <= INT_MAX && h.height <= INT_MAX &&
+                       h.occupancy_stride_words >= (std::uint64_t{h.width} + 63) / 64 &&
+                       h.occupancy_stride_words <= UINT64_MAX / 8 &&
+                       IsPlaneInFile(h.occupancy_offset, h.occupancy_stride_words * 8, h.height, size_) &&
+                       (!HasCosts() || (h.cost_stride_bytes >= h.width &&
+                                        IsPlaneInFile(h.cost_offset, h.cost_stride_bytes, h.height, size_)));
+    if (!valid) {
+        Unmap();
+        throw std::runtime_error(path + " is not a valid grid file");
+    }
+}
+
+MappedGrid::~MappedGrid() {
+    Unmap();
+}
+
+MappedGrid::MappedGrid(MappedGrid&& other) noexcept
+    : mapping_(std::exchange(other.mapping_, nullptr)),
+      data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      header_(std::exchange(other.header_, GridFileHeader{})) {}
+
+MappedGrid& MappedGrid::operator=(MappedGrid&& other) noexcept {
+    if (this != &other) {
+        Unmap();
+        mapping_ = std::exchange(other.mapping_, nullptr);
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        header_ = std::exchange(other.header_, GridFileHeader{});
+    }
+    return *this;
+}
+
+BitGridView MappedGrid::View() const {
+    const auto* words = reinterpret_cast<const std::uint64_t*>(data_ + header_.occupancy_offset);
+    return BitGridView(words, Width(), Height(), header_.occupancy_stride_words);
+}
+
+std::uint8_t MappedGrid::Cost(int x, int y) const {
+    return data_[header_.cost_offset + static_cast<std::uint64_t>(y) * header_.cost_stride_bytes + x];
+}
+
+void MappedGrid::Unmap() {
+#ifdef SP_HAVE_MMAP
+    if (mapping_ != nullptr) {
+        ::munmap(mapping_, size_);
+    }
+#endif
+    mapping_ = nullptr;
+    data_ = nullptr;
+    size_ = 0;
+    header_ = GridFileHeader{};
+}
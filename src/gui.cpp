@@ -1,11 +1,69 @@
 #include "gui.hpp"
 #include "fonts.hpp"
+#include "profiler.hpp"
 
 #include <raylib.h>
 
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <limits>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+// Time-sliced mode limits
+constexpr std::chrono::microseconds kMinFrameBudget{1000};
+constexpr std::chrono::microseconds kMaxFrameBudget{16000};
+constexpr std::size_t kMaxStepsPerFrame = 1 << 20;
+constexpr std::size_t kPreviewCacheEntries = 4096;  // Dropped all at once when full
+
+// Editor state files, relative to the working directory
+constexpr const char* kQuickSavePath = "editor_state.spmap";
+// HUD graph scale and refresh rate of its counters
+constexpr float kHudPixelsPerMs = 3.0f;
+constexpr float kHudFrameBudgetMs = 1000.0f / 60;
+constexpr std::chrono::milliseconds kHudSampleInterval{500};
+
+constexpr const char* kTracePath = "profile_trace.json";
+constexpr const char* kStacksPath = "profile_stacks.folded";
+
 // Constructor
 Gui::Gui()
-    : search_(Search()),
+    : occupancy_(kMaxTilesX, kMaxTilesY),
+      search_worker_(search_events_),
+      search_job_(0),
+      is_time_sliced_(false),
+      is_sliced_search_running_(false),
+      frame_budget_(4000),
+      steps_per_frame_(2),
+      has_search_stats_(false),
+      stats_job_(0),
+      has_search_tree_(false),
+      tree_algorithm_(Algorithm::kBfs),
+      tree_start_({0, 0}),
+      tree_version_(0),
+      is_preview_enabled_(false),
+      is_preview_running_(false),
+      is_preview_current_(false),
+      preview_key_(),
+      preview_latency_(0),
+      preview_frames_(0),
+      shown_key_(),
+      has_preview_(false),
+      preview_cache_version_(0),
+      heatmap_mode_(HeatmapMode::kOff),
+      is_hud_visible_(false),
+      frame_times_(),
+      frame_allocations_(),
+      frame_index_(0),
+      queue_depth_(0),
+      hud_sample_time_(std::chrono::steady_clock::now()),
+      hud_sample_nodes_(0),
+      nodes_per_second_(0.0),
+      resident_bytes_(0),
+      generator_seed_(0),
       mouse_position_({0.0f, 0.0f}),
       origin_state_(TileState::kEmpty),
       start_ptr_(nullptr),
@@ -14,29 +72,24 @@ Gui::Gui()
       start_button_drag_(false),
       goal_button_drag_(false),
       search_executed_(false),
-      is_gui_busy_(false),
       is_vector_field_(false),
       grid_(std::vector<std::vector<Tile>>(kMaxTilesY, std::vector<Tile>(kMaxTilesX))) {
 
+    // The startup is always recorded so the font setup shows up in the first dump, R decides about the frames
+    SetProfilerEnabled(true);
+
+    sliced_search_.SetCountCells(true);
+    sliced_search_.SetPerfCounters(&perf_counters_);
+    sliced_search_.SetReuseTree(true);
+    // Dragging the goal grows the preview's tree, so it only searches cells it hasn't settled yet
+    preview_search_.SetReuseTree(true);
+    preview_search_.SetEmitEvents(false);
+
     SetTargetFPS(60);
     // Set GUI width and height
     InitWindow(kScreenWidth, kScreenHeight, "Shortest Path raylib");
 
-    // Font generation from TTF font byte array
-    // 153616 == hardcoded byte array size of anonymous_pro_bold_ttf
-    font_default_.glyphs = LoadFontData(anonymous_pro_bold_ttf, 153616, 24, nullptr, 95, FONT_DEFAULT);
-    font_default_.baseSize = 24;
-    font_default_.glyphCount = 95;
-    Image atlas = GenImageFontAtlas(font_default_.glyphs, &font_default_.recs, 95, 16, 4, 0);
-    font_default_.texture = LoadTextureFromImage(atlas);
-
-    // 12136 == hardcoded byte array size of arrows_ttf
-    font_unicode_.glyphs = LoadFontData(arrows_ttf, 12136, 24, nullptr, 95, FONT_DEFAULT);
-    font_unicode_.baseSize = 24;
-    font_unicode_.glyphCount = 95;
-    atlas = GenImageFontAtlas(font_unicode_.glyphs, &font_unicode_.recs, 95, 16, 4, 0);
-    font_unicode_.texture = LoadTextureFromImage(atlas);
-    UnloadImage(atlas);
+    LoadFonts();
 
     // Initialize upper buttons
     const int y = 50;
@@ -49,6 +102,12 @@ Gui::Gui()
 
     vector_field_button_ = Tile{10, 13, y, 470, 180, 40, "Vector field"};
 
+    // Second row: procedurally generated maps
+    const char* generator_labels[] = {"Random", "Division", "Maze", "Rooms", "Cave"};
+    for (std::size_t i = 0; i < generator_buttons_.size(); ++i) {
+        generator_buttons_[i] = Tile{0, 0, y + 50, p1 + 130 * static_cast<int>(i), 120, 40, generator_labels[i]};
+    }
+
     int bfs = 700;
     int djk = bfs + 120;
     int ast = djk + 120;
@@ -71,6 +130,8 @@ Gui::Gui()
     grid_[21][46].SetTileGoal();
     start_ptr_ = &grid_[3][3];
     goal_ptr_ = &grid_[21][46];
+    components_.Build(occupancy_);
+    SetProfilerEnabled(false);
 }
 
 Gui::~Gui() {
@@ -79,10 +140,48 @@ Gui::~Gui() {
     CloseWindow();
 }
 
+void Gui::LoadFonts() {
+    PROFILE_ZONE("Gui::LoadFonts");
+    // Font generation from TTF font byte array
+    // 153616 == hardcoded byte array size of anonymous_pro_bold_ttf
+    font_default_.glyphs = LoadFontData(anonymous_pro_bold_ttf, 153616, 24, nullptr, 95, FONT_DEFAULT);
+    font_default_.baseSize = 24;
+    font_default_.glyphCount = 95;
+    Image atlas = GenImageFontAtlas(font_default_.glyphs, &font_default_.recs, 95, 16, 4, 0);
+    font_default_.texture = LoadTextureFromImage(atlas);
+
+    // 12136 == hardcoded byte array size of arrows_ttf
+    font_unicode_.glyphs = LoadFontData(arrows_ttf, 12136, 24, nullptr, 95, FONT_DEFAULT);
+    font_unicode_.baseSize = 24;
+    font_unicode_.glyphCount = 95;
+    atlas = GenImageFontAtlas(font_unicode_.glyphs, &font_unicode_.recs, 95, 16, 4, 0);
+    font_unicode_.texture = LoadTextureFromImage(atlas);
+    UnloadImage(atlas);
+}
+
 void Gui::RunLoop() {
+    using Clock = std::chrono::steady_clock;
+    auto ms = [](Clock::duration time) { return std::chrono::duration<float, std::milli>(time).count(); };
     while (!WindowShouldClose()) {
+        PROFILE_ZONE("Gui::Frame");
+        const auto frame_begin = Clock::now();
+        const AllocCounts allocations_before = ThreadAllocCounts();
+        queue_depth_ = search_events_.SizeApprox();
+        ProcessSearchEvents();
+        StepPreview(StepSlicedSearch(frame_budget_));
+        const auto search_end = Clock::now();
+        ProcessKeys();
         ProcessInput();
+        const auto input_end = Clock::now();
+        present_begin_ = input_end;
         GenerateOutput();
+        // EndDrawing() swaps buffers, waits for the target frame rate and polls the input
+        const auto frame_end = Clock::now();
+        frame_times_[frame_index_] = FrameTimes{ms(input_end - search_end), ms(search_end - frame_begin),
+                                                ms(present_begin_ - input_end), ms(frame_end - present_begin_)};
+        frame_allocations_[frame_index_] = ThreadAllocCounts() - allocations_before;
+        frame_index_ = (frame_index_ + 1) % kHudFrames;
+        SampleHudCounters();
     }
 }
 
@@ -92,25 +191,28 @@ void Gui::ProcessPresetButton(const Vector2& mouse_pos, Tile* button) {
         if (IsMouseButtonDown(MOUSE_BUTTON_LEFT)) {
             button->SetButtonPressed();
         } else if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) {
-            int start_y, start_x, goal_y, goal_x;
-            std::vector<std::vector<int>>* ptr;
             if (button == &preset_button1_) {
-                start_y = 14, start_x = 14, goal_y = 1, goal_x = 43;
-                ptr = &preset_vec1_;
+                ApplyPreset(kPresets[0]);
             } else if (button == &preset_button2_) {
-                start_y = 18, start_x = 12, goal_y = 5, goal_x = 27;
-                ptr = &preset_vec2_;
+                ApplyPreset(kPresets[1]);
             } else {
-                start_y = 11, start_x = 14, goal_y = 11, goal_x = 34;
-                ptr = &preset_vec3_;
+                ApplyPreset(kPresets[2]);
             }
-            start_ptr_->SetTileEmpty();
-            goal_ptr_->SetTileEmpty();
-            PrintPreset(*ptr);
-            grid_[start_y][start_x].SetTileStart();
-            start_ptr_ = &grid_[start_y][start_x];
-            grid_[goal_y][goal_x].SetTileGoal();
-            goal_ptr_ = &grid_[goal_y][goal_x];
+        } else {
+            button->SetButtonHover();
+        }
+    } else {
+        button->SetButtonNormal();
+    }
+}
+
+void Gui::ProcessGeneratorButton(const Vector2& mouse_pos, Tile* button, MapGenerator generator) {
+    if (CheckCollisionPointRec(mouse_pos, button->rec)) {
+        button->SetButtonHover();
+        if (IsMouseButtonDown(MOUSE_BUTTON_LEFT)) {
+            button->SetButtonPressed();
+        } else if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) {
+            ApplyGeneratedMap(generator);
         } else {
             button->SetButtonHover();
         }
@@ -152,22 +254,12 @@ void Gui::ProcessActionButton(const Vector2& mouse_pos, Tile* button) {
             } else if (button == &clear_button_) {
                 ClearGrid();
             } else if (button == &search_button_) {
-                if (search_executed_) {
+                if (search_executed_ && CanReuseSearchTree()) {
+                    PurgePath();
+                } else if (search_executed_) {
                     PurgeGrid();
                 }
-                if (algorithm_ == Algorithm::kBfs) {
-                    std::thread thread(&Search::Bfs, search_, std::ref(grid_), std::ref(start_ptr_), std::ref(goal_ptr_),
-                                       std::ref(is_gui_busy_));
-                    thread.detach();
-                } else if (algorithm_ == Algorithm::kDijkstra) {
-                    std::thread thread(&Search::Dijkstra, search_, std::ref(grid_), std::ref(start_ptr_), std::ref(goal_ptr_),
-                                       std::ref(is_gui_busy_));
-                    thread.detach();
-                } else {
-                    std::thread thread(&Search::AStar, search_, std::ref(grid_), std::ref(start_ptr_), std::ref(goal_ptr_),
-                                       std::ref(is_gui_busy_));
-                    thread.detach();
-                }
+                StartSearch();
                 search_executed_ = true;
             }
         } else {
@@ -178,15 +270,330 @@ void Gui::ProcessActionButton(const Vector2& mouse_pos, Tile* button) {
     }
 }
 
-void Gui::ProcessInput() {
-    if (is_gui_busy_) {
+void Gui::StartSearch() {
+    // Supersedes a search that is still running
+    Coordinates start{start_ptr_->x, start_ptr_->y};
+    Coordinates goal{goal_ptr_->x, goal_ptr_->y};
+    has_search_stats_ = false;
+    stats_job_ = 0;
+    cell_counters_ = CellCounters();
+    status_message_.clear();  // A "no path" from an earlier search no longer applies
+    // Only a tree that is still on screen may grow, the search adds just the cells it reaches from now on
+    const bool reuse_tree = CanReuseSearchTree();
+    has_search_tree_ = false;
+    tree_algorithm_ = algorithm_;
+    tree_start_ = start;
+    tree_version_ = occupancy_.Version();
+    if (!components_.IsConnected(start, goal)) {
+        // Nothing to search, the engines would only flood the start's region to find that out
+        AbortSearch();
+        status_message_ = "No path: start and goal are in different components";
         return;
     }
+    if (is_time_sliced_) {
+        sliced_search_.SetReuseTree(reuse_tree);
+        sliced_search_.Begin(algorithm_, occupancy_.Snapshot(), start, goal);
+        is_sliced_search_running_ = true;
+    } else {
+        search_job_ = search_worker_.Submit(algorithm_, occupancy_.Snapshot(), start, goal, reuse_tree);
+    }
+}
+
+bool Gui::IsSearchRunning() const {
+    return search_job_ != 0 || is_sliced_search_running_;
+}
+
+void Gui::AbortSearch() {
+    if (search_job_ != 0) {
+        search_worker_.CancelAll();
+        search_job_ = 0;
+    }
+    is_sliced_search_running_ = false;
+}
+
+std::chrono::microseconds Gui::StepSlicedSearch(std::chrono::microseconds budget) {
+    PROFILE_ZONE("Gui::StepSlicedSearch");
+    if (!is_sliced_search_running_) {
+        return budget;
+    }
+    const auto begin = std::chrono::steady_clock::now();
+    sliced_events_.clear();
+    sliced_search_.RunFor(budget, steps_per_frame_, sliced_events_);
+    for (const auto& event : sliced_events_) {
+        ApplySearchEvent(event);
+    }
+    if (sliced_search_.IsDone()) {
+        is_sliced_search_running_ = false;
+        search_stats_ = sliced_search_.Stats();
+        has_search_stats_ = true;
+        has_search_tree_ = true;
+    }
+    const auto used = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin);
+    return std::max(budget - used, std::chrono::microseconds(0));
+}
+
+void Gui::StepPreview(std::chrono::microseconds budget) {
+    PROFILE_ZONE("Gui::StepPreview");
+    if (!is_preview_enabled_ || !(start_button_drag_ || goal_button_drag_)) {
+        is_preview_running_ = false;
+        has_preview_ = false;
+        return;
+    }
+    const Coordinates start{start_ptr_->x, start_ptr_->y};
+    const Coordinates goal{goal_ptr_->x, goal_ptr_->y};
+    const PreviewKey key{algorithm_, start, goal, occupancy_.Version()};
+    if (key.version != preview_cache_version_ || preview_cache_.size() >= kPreviewCacheEntries) {
+        preview_cache_.clear();
+        preview_cache_version_ = key.version;
+    }
+    auto show = [&](const PreviewResult& result) {
+        preview_ = result;
+        shown_key_ = key;
+        has_preview_ = true;
+        is_preview_current_ = true;
+    };
+    if (const auto it = preview_cache_.find(key); it != preview_cache_.end()) {
+        is_preview_running_ = false;
+        show(it->second);
+        return;
+    }
+    if (!components_.IsConnected(start, goal)) {
+        is_preview_running_ = false;
+        show(preview_cache_[key] = PreviewResult{});
+        return;
+    }
+
+    // A query that ran out of budget goes on, one for other positions replaces it
+    if (!is_preview_running_ || !(preview_key_ == key)) {
+        preview_search_.Begin(algorithm_, occupancy_.Snapshot(), start, goal);
+        preview_key_ = key;
+        preview_latency_ = std::chrono::nanoseconds(0);
+        preview_frames_ = 0;
+        is_preview_running_ = true;
+    }
+    const auto begin = std::chrono::steady_clock::now();
+    std::vector<SearchEvent> no_events;
+    preview_search_.RunFor(budget, std::numeric_limits<std::size_t>::max(), no_events);
+    preview_latency_ += std::chrono::steady_clock::now() - begin;
+    ++preview_frames_;
+    if (!preview_search_.IsDone()) {
+        // Over budget: the last valid path stays, dimmed
+        is_preview_current_ = false;
+        return;
+    }
+    is_preview_running_ = false;
+    PreviewResult result;
+    result.found = preview_search_.IsPathFound();
+    result.path = preview_search_.Path();
+    result.latency = preview_latency_;
+    result.frames = preview_frames_;
+    result.nodes_expanded = preview_search_.NodesExpanded();
+    show(preview_cache_[key] = std::move(result));
+}
+
+void Gui::ProcessSearchEvents() {
+    PROFILE_ZONE("Gui::ProcessSearchEvents");
+    SearchEvent event;
+    while (search_events_.TryPop(event)) {
+        if (event.job_id != search_job_ || event.version != occupancy_.Version()) {
+            continue;  // Left over from an aborted job or computed on an outdated grid
+        }
+        if (event.type == SearchEventType::kDone) {
+            search_job_ = 0;
+            stats_job_ = event.job_id;
+            has_search_tree_ = true;
+        }
+        ApplySearchEvent(event);
+    }
+    // The worker stores the statistics right after sending kDone, so they may take another frame
+    if (stats_job_ != 0 && search_worker_.LatestStats(stats_job_, search_stats_, &cell_counters_)) {
+        stats_job_ = 0;
+        has_search_stats_ = true;
+    }
+}
+
+void Gui::ApplySearchEvent(const SearchEvent& event) {
+    Tile& tile = grid_[event.at.y][event.at.x];
+    if (event.type == SearchEventType::kDone || tile.IsTileStart()) {
+        return;
+    }
+    if (tile.IsTileGoal()) {
+        // Shows up once the goal is dragged on
+        if (event.type == SearchEventType::kVisit) {
+            origin_state_ = TileState::kVisited;
+            tile.text = std::string(1, event.arrow);
+        }
+        return;
+    }
+    if (event.type == SearchEventType::kVisit) {
+        tile.SetTileVisited();
+        tile.text = std::string(1, event.arrow);
+    } else {
+        tile.SetTilePath();
+    }
+}
+
+void Gui::ProcessKeys() {
+    // T switches between the worker thread and time-sliced stepping
+    if (IsKeyPressed(KEY_T)) {
+        // A search in flight goes on in the other mode, from the start
+        const bool restart_search = IsSearchRunning();
+        PurgeGrid();
+        is_time_sliced_ = !is_time_sliced_;
+        if (restart_search) {
+            StartSearch();
+            search_executed_ = true;
+        }
+    }
+    // Up/Down tune the per-frame budget, Left/Right the step cap of the time-sliced mode
+    if (IsKeyPressed(KEY_UP)) {
+        frame_budget_ = std::min(frame_budget_ + std::chrono::microseconds(1000), kMaxFrameBudget);
+    } else if (IsKeyPressed(KEY_DOWN)) {
+        frame_budget_ = std::max(frame_budget_ - std::chrono::microseconds(1000), kMinFrameBudget);
+    }
+    if (IsKeyPressed(KEY_RIGHT)) {
+        steps_per_frame_ = std::min(steps_per_frame_ * 2, kMaxStepsPerFrame);
+    } else if (IsKeyPressed(KEY_LEFT)) {
+        steps_per_frame_ = std::max(steps_per_frame_ / 2, std::size_t{1});
+    }
+    // F5 saves the editor, F9 restores it, 1-3 load the presets like their buttons
+    if (IsKeyPressed(KEY_F5)) {
+        SaveState(kQuickSavePath);
+    } else if (IsKeyPressed(KEY_F9)) {
+        LoadState(kQuickSavePath);
+    }
+    for (int i = 0; i < 3; ++i) {
+        if (IsKeyPressed(KEY_ONE + i)) {
+            ApplyPreset(kPresets[i]);
+        }
+    }
+    // M cycles the heatmap between expansions, pushes and off
+    if (IsKeyPressed(KEY_M)) {
+        heatmap_mode_ = heatmap_mode_ == HeatmapMode::kOff          ? HeatmapMode::kExpansions
+                        : heatmap_mode_ == HeatmapMode::kExpansions ? HeatmapMode::kPushes
+                                                                    : HeatmapMode::kOff;
+    }
+    if (IsKeyPressed(KEY_H)) {
+        is_hud_visible_ = !is_hud_visible_;
+    }
+    // L toggles the live path preview while dragging start or goal
+    if (IsKeyPressed(KEY_L)) {
+        is_preview_enabled_ = !is_preview_enabled_;
+    }
+    // R switches zone recording on and off, P dumps the zones recorded so far
+    if (IsKeyPressed(KEY_R)) {
+        SetProfilerEnabled(!IsProfilerEnabled());
+        status_message_ = IsProfilerEnabled() ? "Profiler recording" : "Profiler stopped";
+    }
+    if (IsKeyPressed(KEY_P)) {
+        DumpProfile();
+    }
+}
+
+void Gui::DumpProfile() {
+    try {
+        WriteChromeTrace(kTracePath);
+        WriteCollapsedStacks(kStacksPath);
+        status_message_ = std::string("Wrote ") + kTracePath + " and " + kStacksPath;
+    } catch (const std::exception& e) {
+        status_message_ = e.what();
+    }
+}
+
+EditorState Gui::CaptureState() const {
+    EditorState state;
+    state.width = kMaxTilesX;
+    state.height = kMaxTilesY;
+    state.obstacles.resize(static_cast<std::size_t>(kMaxTilesX) * kMaxTilesY);
+    for (int y = 0; y < kMaxTilesY; ++y) {
+        for (int x = 0; x < kMaxTilesX; ++x) {
+            state.obstacles[y * kMaxTilesX + x] = grid_[y][x].IsTileObstacle() ? 1 : 0;
+        }
+    }
+    state.start = Coordinates{start_ptr_->x, start_ptr_->y};
+    state.goal = Coordinates{goal_ptr_->x, goal_ptr_->y};
+    state.algorithm = algorithm_;
+    return state;
+}
+
+void Gui::ApplyState(const EditorState& state) {
+    ClearGrid();
+    start_ptr_->SetTileEmpty();
+    goal_ptr_->SetTileEmpty();
+    for (int y = 0; y < kMaxTilesY; ++y) {
+        for (int x = 0; x < kMaxTilesX; ++x) {
+            if (state.obstacles[y * kMaxTilesX + x] != 0) {
+                grid_[y][x].SetTileObstacle();
+                occupancy_.SetObstacle(x, y, true);
+            }
+        }
+    }
+    // Start and goal win over obstacles underneath them
+    start_ptr_ = &grid_[state.start.y][state.start.x];
+    goal_ptr_ = &grid_[state.goal.y][state.goal.x];
+    occupancy_.SetObstacle(state.start.x, state.start.y, false);
+    occupancy_.SetObstacle(state.goal.x, state.goal.y, false);
+    // Saved components spare the labelling, any that don't fit the grid get rebuilt
+    const EditorIndex* index = FindEditorIndex(state, kComponentLabelsTag);
+    const std::size_t cells = static_cast<std::size_t>(kMaxTilesX) * kMaxTilesY;
+    std::vector<std::uint32_t> labels;
+    if (index == nullptr || !DecodeLabelIndex(*index, cells, labels) || !components_.Assign(occupancy_, labels)) {
+        components_.Build(occupancy_);
+    }
+    start_ptr_->SetTileStart();
+    goal_ptr_->SetTileGoal();
+    algorithm_ = state.algorithm;
+}
+
+void Gui::ApplyGeneratedMap(MapGenerator generator) {
+    const std::uint64_t seed = ++generator_seed_;
+    GeneratedMap map = GenerateMap(generator, kMaxTilesX, kMaxTilesY, seed);
+    EditorState state;
+    state.width = map.width;
+    state.height = map.height;
+    state.obstacles = std::move(map.cells);
+    state.start = map.start;
+    state.goal = map.goal;
+    state.algorithm = algorithm_;
+    ApplyState(state);
+    status_message_ = TextFormat("%s map, seed %llu", MapGeneratorName(generator), static_cast<unsigned long long>(seed));
+}
+
+void Gui::SaveState(const std::string& path) {
+    try {
+        EditorState state = CaptureState();
+        state.indices.push_back(EncodeLabelIndex(kComponentLabelsTag, components_.Labels()));
+        SaveEditorState(path, state);
+        status_message_ = "Saved " + path;
+    } catch (const std::exception& e) {
+        status_message_ = e.what();
+    }
+}
+
+void Gui::LoadState(const std::string& path) {
+    try {
+        EditorState state = LoadEditorState(path);
+        if (state.width != kMaxTilesX || state.height != kMaxTilesY || state.start == state.goal) {
+            status_message_ = path + " doesn't fit the editor";
+            return;
+        }
+        ApplyState(state);
+        status_message_ = "Loaded " + path;
+    } catch (const std::exception& e) {
+        status_message_ = e.what();
+    }
+}
+
+void Gui::ProcessInput() {
+    PROFILE_ZONE("Gui::ProcessInput");
     mouse_position_ = GetMousePosition();
 
     ProcessPresetButton(mouse_position_, &preset_button1_);
     ProcessPresetButton(mouse_position_, &preset_button2_);
     ProcessPresetButton(mouse_position_, &preset_button3_);
+    for (std::size_t i = 0; i < generator_buttons_.size(); ++i) {
+        ProcessGeneratorButton(mouse_position_, &generator_buttons_[i], kAllMapGenerators[i]);
+    }
 
     ProcessActionButton(mouse_position_, &vector_field_button_);
 
@@ -197,30 +604,46 @@ void Gui::ProcessInput() {
     ProcessActionButton(mouse_position_, &clear_button_);
     ProcessActionButton(mouse_position_, &search_button_);
 
+    // Edits purge the search on screen right before they land. One still in flight starts over on the edited
+    // grid once the edit is done, instead of getting dropped.
+    bool restart_search = false;
+    auto purge_for_edit = [&](bool moves_goal) {
+        restart_search = restart_search || IsSearchRunning();
+        // Moving only the goal keeps the explored cells, the next search grows the same tree
+        if (search_executed_ && moves_goal && CanReuseSearchTree()) {
+            PurgePath();
+        } else if (search_executed_) {
+            PurgeGrid();
+        }
+    };
+
     // Process grid
     for (auto& row : grid_) {
         for (auto& tile : row) {
             if (CheckCollisionPointRec(mouse_position_, tile.rec)) {
                 // Use left mouse button to place obstacles or drag and drop start and goal
                 if (IsMouseButtonDown(MOUSE_BUTTON_LEFT)) {
-                    if (search_executed_) {
-                        PurgeGrid();
-                        search_executed_ = false;
-                    }
+                    // Tiles of the search on screen are as good as empty, the purge clears them first
+                    const bool is_free = tile.IsTileEmpty() || (search_executed_ && (tile.IsTileVisited() || tile.IsTilePath()));
                     if (start_button_drag_) {
-                        if (tile.IsTileEmpty()) {
+                        if (is_free) {
+                            purge_for_edit(false);
                             tile.SetTileStart();
                             start_ptr_->SetTileEmpty();
                             start_ptr_ = &tile;
                         }
                     } else if (goal_button_drag_) {
-                        if (tile.IsTileEmpty()) {
+                        if (is_free || tile.IsTileVisited()) {
+                            purge_for_edit(true);
+                            // The cell left behind gets back what the goal covered, an explored one with its arrow
+                            goal_ptr_->tile_state = origin_state_;
+                            origin_state_ = tile.tile_state;
                             tile.SetTileGoal();
-                            goal_ptr_->SetTileEmpty();
                             goal_ptr_ = &tile;
                         }
-                    } else if (tile.IsTileEmpty()) {
-                        tile.SetTileObstacle();
+                    } else if (is_free) {
+                        purge_for_edit(false);
+                        SetObstacle(tile, true);
                     } else if (tile.IsTileStart()) {
                         start_button_drag_ = true;
                     } else if (tile.IsTileGoal()) {
@@ -230,11 +653,8 @@ void Gui::ProcessInput() {
                 // Use right mouse button to erase obstacles
                 else if (IsMouseButtonDown(MOUSE_BUTTON_RIGHT)) {
                     if (tile.IsTileObstacle()) {
-                        if (search_executed_) {
-                            PurgeGrid();
-                            search_executed_ = false;
-                        }
-                        tile.SetTileEmpty();
+                        purge_for_edit(false);
+                        SetObstacle(tile, false);
                     }
                 }
             } else if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) {
@@ -243,6 +663,10 @@ void Gui::ProcessInput() {
             }
         }
     }
+    if (restart_search) {
+        StartSearch();
+        search_executed_ = true;
+    }
 }
 
 void Gui::GeneratePresetButton(const Vector2& mouse_pos, const Tile* button) {
@@ -294,6 +718,7 @@ void Gui::OutlineAlgorithmButton() {
 }
 
 void Gui::GenerateOutput() {
+    PROFILE_ZONE("Gui::GenerateOutput");
     BeginDrawing();
     {
         ClearBackground(RAYWHITE);
@@ -301,6 +726,9 @@ void Gui::GenerateOutput() {
         GeneratePresetButton(mouse_position_, &preset_button1_);
         GeneratePresetButton(mouse_position_, &preset_button2_);
         GeneratePresetButton(mouse_position_, &preset_button3_);
+        for (const auto& button : generator_buttons_) {
+            GeneratePresetButton(mouse_position_, &button);
+        }
 
         GenerateActionButton(mouse_position_, &vector_field_button_, DARKBLUE);
         if (is_vector_field_) {
@@ -314,8 +742,11 @@ void Gui::GenerateOutput() {
 
         GenerateActionButton(mouse_position_, &clear_button_, SKYBLUE);
         GenerateActionButton(mouse_position_, &search_button_, DARKGREEN);
+        GenerateStatusLine();
+        GenerateStatsPanel();
 
         int offset;
+        const bool goal_reachable = IsGoalReachable();
         for (const auto& row : grid_) {
             for (const auto& tile : row) {
                 if (tile.IsTileObstacle()) {
@@ -326,6 +757,9 @@ void Gui::GenerateOutput() {
                 } else if (tile.IsTileGoal()) {
                     DrawRectangleRec(tile.rec, RED);
                     DrawTextEx(font_default_, "G", Vector2{tile.rec.x + 7, tile.rec.y + 2}, tile.font_size, 0, RAYWHITE);
+                    if (!goal_reachable) {
+                        DrawRectangleLinesEx(tile.rec, 3.0f, BLACK);
+                    }
                 } else if (tile.IsTileVisited()) {
                     DrawRectangleRec(tile.rec, Fade(DARKBLUE, 0.3f));
                     offset = (tile.text == "C" || tile.text == "D") ? 8 : 3;
@@ -338,11 +772,214 @@ void Gui::GenerateOutput() {
                 }
             }
         }
+        GeneratePreview();
+        GenerateHeatmap();
+        GenerateHud();
     }
+    present_begin_ = std::chrono::steady_clock::now();
     EndDrawing();
 }
 
+void Gui::GenerateStatusLine() {
+    const char* text = "Threaded search [T]";
+    if (is_time_sliced_) {
+        text = TextFormat("Time-sliced: %d ms, %d steps/frame [T] [Up/Down] [Left/Right]",
+                          static_cast<int>(frame_budget_.count() / 1000), static_cast<int>(steps_per_frame_));
+    }
+    DrawTextEx(font_default_, text, Vector2{40, 12}, 20, 0, DARKGRAY);
+    if (is_preview_enabled_) {
+        const char* preview = "Live preview [L]: drag start or goal";
+        if (has_preview_) {
+            const char* outcome = preview_.found ? TextFormat("path %zu", preview_.path.size()) : "no path";
+            preview = TextFormat("Live preview [L]: %s  %.2f ms in %zu frame(s)  %zu expanded  %zu cached%s", outcome,
+                                 static_cast<double>(preview_.latency.count()) / 1e6, preview_.frames,
+                                 preview_.nodes_expanded, preview_cache_.size(),
+                                 is_preview_current_ ? "" : "  over budget, showing the last path");
+        }
+        DrawTextEx(font_default_, preview, Vector2{40, 32}, 16, 0, DARKGRAY);
+    }
+    DrawTextEx(font_default_, status_message_.c_str(), Vector2{760, 12}, 20, 0, DARKGRAY);
+    if (!IsGoalReachable()) {
+        DrawTextEx(font_default_, "Goal unreachable: walled off from the start", Vector2{760, 32}, 16, 0, MAROON);
+    }
+}
+
+void Gui::GenerateStatsPanel() {
+    if (!has_search_stats_) {
+        return;
+    }
+    const SearchStats& stats = search_stats_;
+    auto ms = [](std::chrono::nanoseconds time) { return static_cast<double>(time.count()) / 1e6; };
+    const char* work = TextFormat("expanded %zu  generated %zu  peak %zu  dup %zu  re-exp %zu",
+                                  stats.nodes_expanded, stats.nodes_generated, stats.frontier_peak, stats.duplicate_pushes,
+                                  stats.re_expansions);
+    if (kAllocTrackingEnabled) {
+        work = TextFormat("%s  allocs %llu", work, static_cast<unsigned long long>(stats.allocations.allocations));
+    }
+    if (stats.resumed) {
+        work = TextFormat("%s  resumed", work);
+    }
+    DrawTextEx(font_default_, work, Vector2{720, 98}, 16, 0, DARKGRAY);
+    const char* cost = TextFormat("path %zu cost %.2f  setup/search/path %.2f/%.2f/%.2f ms  %zu KiB", stats.path_length,
+                                  stats.path_cost, ms(stats.setup_time), ms(stats.search_time), ms(stats.reconstruction_time),
+                                  stats.bytes_allocated / 1024);
+    DrawTextEx(font_default_, cost, Vector2{720, 114}, 16, 0, DARKGRAY);
+    const PerfCounts& perf = stats.perf;
+    const char* counters = TextFormat("%s counters: %.2f M instr  %.0f k llc-miss  %.0f k br-miss  %llu faults  %llu ctx-sw",
+                                      PerfSourceName(perf.source), static_cast<double>(perf.instructions) / 1e6,
+                                      static_cast<double>(perf.cache_misses) / 1e3, static_cast<double>(perf.branch_misses) / 1e3,
+                                      static_cast<unsigned long long>(perf.page_faults),
+                                      static_cast<unsigned long long>(perf.context_switches));
+    DrawTextEx(font_default_, counters, Vector2{720, 130}, 16, 0, DARKGRAY);
+}
+
+void Gui::GeneratePreview() {
+    if (!has_preview_) {
+        return;
+    }
+    // A line through the tile centres from start to goal
+    auto center = [this](Coordinates at) {
+        const Rectangle& rec = grid_[at.y][at.x].rec;
+        return Vector2{rec.x + rec.width / 2, rec.y + rec.height / 2};
+    };
+    const Color color = is_preview_current_ ? ORANGE : Fade(ORANGE, 0.35f);
+    Vector2 from = center(shown_key_.start);
+    for (auto it = preview_.path.rbegin(); it != preview_.path.rend(); ++it) {
+        const Vector2 to = center(*it);
+        DrawLineEx(from, to, 4.0f, color);
+        from = to;
+    }
+}
+
+void Gui::GenerateHeatmap() {
+    if (heatmap_mode_ == HeatmapMode::kOff) {
+        return;
+    }
+    const CellCounters& counters = is_time_sliced_ ? sliced_search_.Counters() : cell_counters_;
+    const bool expansions = heatmap_mode_ == HeatmapMode::kExpansions;
+    const char* what = expansions ? "expansions" : "pushes";
+    if (counters.IsEmpty() || counters.width != kMaxTilesX || counters.height != kMaxTilesY) {
+        DrawTextEx(font_default_, TextFormat("Heatmap of %s: no finished search [M]", what), Vector2{40, 32}, 16, 0, DARKGRAY);
+        return;
+    }
+    const auto& plane = expansions ? counters.expansions : counters.pushes;
+    const std::uint32_t max_count = *std::max_element(plane.begin(), plane.end());
+    const auto redundant = std::count_if(plane.begin(), plane.end(), [](std::uint32_t count) { return count > 1; });
+    const char* legend =
+        TextFormat("Heatmap of %s: max %u, %d cells more than once [M]", what, max_count, static_cast<int>(redundant));
+    DrawTextEx(font_default_, legend, Vector2{40, 32}, 16, 0, DARKGRAY);
+
+    // Yellow for cells touched once up to red for the hottest one, only where the search left a trace
+    for (const auto& row : grid_) {
+        for (const auto& tile : row) {
+            const std::uint32_t count = plane[counters.Index(tile.x, tile.y)];
+            if (count == 0 || !(tile.IsTileVisited() || tile.IsTilePath())) {
+                continue;
+            }
+            const float heat = max_count > 1 ? static_cast<float>(count - 1) / static_cast<float>(max_count - 1) : 0.0f;
+            DrawRectangleRec(tile.rec, Fade(ColorFromHSV(60.0f * (1.0f - heat), 0.85f, 1.0f), 0.8f));
+            if (count > 1) {
+                DrawTextEx(font_default_, TextFormat("%u", count), Vector2{tile.rec.x + 4, tile.rec.y + 5}, 16, 0, BLACK);
+            }
+        }
+    }
+}
+
+void Gui::SampleHudCounters() {
+    const auto now = std::chrono::steady_clock::now();
+    const auto elapsed = now - hud_sample_time_;
+    if (elapsed < kHudSampleInterval) {
+        return;
+    }
+    const std::size_t nodes = is_time_sliced_ ? sliced_search_.NodesExpanded() : search_worker_.NodesExpanded();
+    // Fewer nodes than last time means a new search started in between
+    const std::size_t progress = nodes >= hud_sample_nodes_ ? nodes - hud_sample_nodes_ : nodes;
+    nodes_per_second_ = static_cast<double>(progress) / std::chrono::duration<double>(elapsed).count();
+    hud_sample_nodes_ = nodes;
+    hud_sample_time_ = now;
+
+#ifdef __linux__
+    // Second field of statm is the resident set in pages
+    std::ifstream statm("/proc/self/statm");
+    std::size_t size_pages = 0, resident_pages = 0;
+    if (statm >> size_pages >> resident_pages) {
+        resident_bytes_ = resident_pages * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    }
+#endif
+}
+
+void Gui::GenerateHud() {
+    if (!is_hud_visible_) {
+        return;
+    }
+    const int x = 880, y = 160, width = 440;
+    const int graph_height = static_cast<int>(2 * kHudFrameBudgetMs * kHudPixelsPerMs);
+    DrawRectangle(x, y, width, graph_height + 140, Fade(BLACK, 0.75f));
+
+    // One stacked bar per frame, oldest on the left, the red line is the 60 FPS budget
+    const int graph_x = x + 10, graph_bottom = y + 10 + graph_height;
+    float worst = 0, total = 0;
+    FrameTimes average;
+    for (std::size_t i = 0; i < kHudFrames; ++i) {
+        const FrameTimes& frame = frame_times_[(frame_index_ + i) % kHudFrames];
+        const float segments[] = {frame.search, frame.input, frame.render, frame.present};
+        const Color colors[] = {ORANGE, SKYBLUE, LIME, GRAY};
+        float stacked = 0;
+        for (int s = 0; s < 4; ++s) {
+            const float bottom = std::min(stacked * kHudPixelsPerMs, static_cast<float>(graph_height));
+            const float top = std::min((stacked + segments[s]) * kHudPixelsPerMs, static_cast<float>(graph_height));
+            DrawRectangle(graph_x + 2 * static_cast<int>(i), graph_bottom - static_cast<int>(top), 2,
+                          static_cast<int>(top) - static_cast<int>(bottom), colors[s]);
+            stacked += segments[s];
+        }
+        worst = std::max(worst, stacked);
+        total += stacked;
+        average.search += frame.search / kHudFrames;
+        average.input += frame.input / kHudFrames;
+        average.render += frame.render / kHudFrames;
+        average.present += frame.present / kHudFrames;
+    }
+    const int budget_y = graph_bottom - static_cast<int>(kHudFrameBudgetMs * kHudPixelsPerMs);
+    DrawLine(graph_x, budget_y, graph_x + 2 * static_cast<int>(kHudFrames), budget_y, RED);
+
+    int line_y = graph_bottom + 8;
+    auto line = [&](const char* text, Color color, int offset = 0) {
+        DrawTextEx(font_default_, text, Vector2{static_cast<float>(x + 10 + offset), static_cast<float>(line_y)}, 16, 0, color);
+    };
+    line(TextFormat("frame avg %.1f ms  max %.1f ms  [H]", total / kHudFrames, worst), RAYWHITE);
+    line_y += 20;
+    line(TextFormat("search %.1f", average.search), ORANGE);
+    line(TextFormat("input %.1f", average.input), SKYBLUE, 110);
+    line(TextFormat("render %.1f", average.render), LIME, 210);
+    line(TextFormat("present %.1f", average.present), LIGHTGRAY, 320);
+    line_y += 20;
+    line(TextFormat("%.0f nodes/s  queue %zu/%zu", nodes_per_second_, queue_depth_, SearchEventQueue::MaxSize()), RAYWHITE);
+    line_y += 20;
+    const std::size_t search_bytes = is_time_sliced_ ? sliced_search_.MemoryBytes() : search_worker_.MemoryBytes();
+    const std::size_t tile_bytes = static_cast<std::size_t>(kMaxTilesX) * kMaxTilesY * sizeof(Tile);
+    line(TextFormat("grid %zu KiB  tiles %zu KiB  search %zu KiB  rss %zu MiB", occupancy_.MemoryBytes() / 1024,
+                    tile_bytes / 1024, search_bytes / 1024, resident_bytes_ >> 20),
+         RAYWHITE);
+    line_y += 20;
+    line(TextFormat("%zu components  last edit visited %zu cells  %zu KiB", components_.ComponentCount(),
+                    components_.LastUpdateCells(), components_.MemoryBytes() / 1024),
+         RAYWHITE);
+    line_y += 20;
+    if (kAllocTrackingEnabled) {
+        AllocCounts allocations;
+        for (const AllocCounts& frame : frame_allocations_) {
+            allocations += frame;
+        }
+        line(TextFormat("%.1f allocs/frame  %.1f KiB/frame", static_cast<double>(allocations.allocations) / kHudFrames,
+                        static_cast<double>(allocations.bytes) / 1024.0 / kHudFrames),
+             RAYWHITE);
+    } else {
+        line("allocations: configure with ENABLE_ALLOC_TRACKING", GRAY);
+    }
+}
+
 void Gui::ClearGrid() {
+    AbortSearch();
     for (auto& row : grid_) {
         for (auto& tile : row) {
             if (!tile.IsTileStart() && !tile.IsTileGoal()) {
@@ -351,10 +988,34 @@ void Gui::ClearGrid() {
             }
         }
     }
+    occupancy_.Clear();
+    components_.Build(occupancy_);
+    origin_state_ = TileState::kEmpty;
     search_executed_ = false;
 }
 
+void Gui::SetObstacle(Tile& tile, bool obstacle) {
+    if (obstacle) {
+        tile.SetTileObstacle();
+    } else {
+        tile.SetTileEmpty();
+    }
+    occupancy_.SetObstacle(tile.x, tile.y, obstacle);
+    components_.SetObstacle(tile.x, tile.y, obstacle);
+}
+
+bool Gui::CanReuseSearchTree() const {
+    // A* orders its tree by the goal, so it always starts over
+    return has_search_tree_ && algorithm_ != Algorithm::kAStar && algorithm_ == tree_algorithm_ &&
+           Coordinates{start_ptr_->x, start_ptr_->y} == tree_start_ && occupancy_.Version() == tree_version_;
+}
+
+bool Gui::IsGoalReachable() {
+    return components_.IsConnected(Coordinates{start_ptr_->x, start_ptr_->y}, Coordinates{goal_ptr_->x, goal_ptr_->y});
+}
+
 void Gui::PurgeGrid() {
+    AbortSearch();
     for (auto& row : grid_) {
         for (auto& tile : row) {
             if (tile.IsTilePath() || tile.IsTileVisited()) {
@@ -363,12 +1024,41 @@ void Gui::PurgeGrid() {
             }
         }
     }
+    origin_state_ = TileState::kEmpty;
+    has_search_tree_ = false;
     search_executed_ = false;
 }
 
-void Gui::PrintPreset(const std::vector<std::vector<int>>& vec) {
-    ClearGrid();
-    for (const auto& v : vec) {
-        grid_[v[0]][v[1]].SetTileObstacle();
+void Gui::PurgePath() {
+    AbortSearch();
+    for (auto& row : grid_) {
+        for (auto& tile : row) {
+            if (tile.IsTilePath()) {
+                tile.SetTileVisited();
+            }
+        }
     }
 }
+
+void Gui::ApplyPreset(const PresetMap& preset) {
+    AbortSearch();
+    for (int y = 0; y < kMaxTilesY; ++y) {
+        for (int x = 0; x < kMaxTilesX; ++x) {
+            Tile& tile = grid_[y][x];
+            tile.text.clear();
+            if (preset.IsObstacle(x, y)) {
+                tile.SetTileObstacle();
+            } else {
+                tile.SetTileEmpty();
+            }
+        }
+    }
+    occupancy_.Assign(preset.View());
+    components_.Build(occupancy_);
+    start_ptr_ = &grid_[preset.start.y][preset.start.x];
+    goal_ptr_ = &grid_[preset.goal.y][preset.goal.x];
+    start_ptr_->SetTileStart();
+    goal_ptr_->SetTileGoal();
+    origin_state_ = TileState::kEmpty;
+    search_executed_ = false;
+}
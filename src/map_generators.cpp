@@ -0,0 +1,356 @@
+#include "map_generators.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+#include <thread>
+
+#include "parallel_for.hpp"
+
+namespace {
+
+constexpr double kDefaultFillDensity = 0.25;
+constexpr double kDefaultCaveDensity = 0.45;
+constexpr int kCaveIterations = 5;
+constexpr int kMazeBandRows = 64;  // Maze cell rows carved by one task
+
+// SplitMix64 finalizer
+std::uint64_t Mix(std::uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// Spreads a seed and a position into an independent stream
+std::uint64_t StreamSeed(std::uint64_t seed, std::uint64_t a, std::uint64_t b = 0) {
+    return Mix(seed ^ Mix(a ^ Mix(b)));
+}
+
+// SplitMix64 generator. Unlike std::mt19937_64 it is free to seed, and there is one per row or region.
+class Rng {
+public:
+    explicit Rng(std::uint64_t seed) : state_(seed) {}
+
+    std::uint64_t operator()() {
+        state_ += 0x9e3779b97f4a7c15ull;
+        return Mix(state_);
+    }
+    // The modulo bias doesn't matter for map layouts
+    int Below(int n) {
+        return static_cast<int>((*this)() % static_cast<std::uint64_t>(n));
+    }
+    int Between(int lo, int hi) {
+        return lo + Below(hi - lo + 1);
+    }
+    bool Chance(double p) {
+        return static_cast<double>((*this)() >> 11) * 0x1.0p-53 < p;
+    }
+
+private:
+    std::uint64_t state_;
+};
+
+unsigned WorkerCount(const GeneratedMap& map) {
+    if (static_cast<std::size_t>(map.width) * map.height < kParallelGenerateCells) {
+        return 1;
+    }
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+class MapWriter {
+public:
+    explicit MapWriter(GeneratedMap& map) : map_(map) {}
+
+    void Set(int x, int y, bool obstacle) {
+        map_.cells[static_cast<std::size_t>(y) * map_.width + x] = obstacle ? 1 : 0;
+    }
+    void FillRow(int y, bool obstacle) {
+        std::memset(map_.cells.data() + static_cast<std::size_t>(y) * map_.width, obstacle ? 1 : 0, map_.width);
+    }
+    void FillRect(int x0, int y0, int x1, int y1, bool obstacle) {
+        for (int y = y0; y <= y1; ++y) {
+            for (int x = x0; x <= x1; ++x) {
+                Set(x, y, obstacle);
+            }
+        }
+    }
+
+private:
+    GeneratedMap& map_;
+};
+
+void RandomFill(GeneratedMap& map, std::uint64_t seed, double density, unsigned workers) {
+    MapWriter writer(map);
+    // One stream per row keeps the result independent of the thread count
+    ParallelFor(map.height, workers, [&](std::size_t y) {
+        Rng rng(StreamSeed(seed, y));
+        for (int x = 0; x < map.width; ++x) {
+            writer.Set(x, static_cast<int>(y), rng.Chance(density));
+        }
+    });
+}
+
+// Smooths random noise with the 4-5 rule: a cell becomes a wall if at least 5 of the 9 cells around it are walls
+void Cave(GeneratedMap& map, std::uint64_t seed, double density, unsigned workers) {
+    RandomFill(map, seed, density, workers);
+    std::vector<std::uint8_t> next(map.cells.size());
+    for (int i = 0; i < kCaveIterations; ++i) {
+        ParallelFor(map.height, workers, [&](std::size_t row) {
+            const int y = static_cast<int>(row);
+            for (int x = 0; x < map.width; ++x) {
+                int walls = 0;
+                for (int dy = -1; dy <= 1; ++dy) {
+                    for (int dx = -1; dx <= 1; ++dx) {
+                        const int nx = x + dx, ny = y + dy;
+                        // The outside counts as wall so that caves close up at the border
+                        walls += nx < 0 || ny < 0 || nx >= map.width || ny >= map.height || map.IsObstacle(nx, ny);
+                    }
+                }
+                next[row * map.width + x] = walls >= 5 ? 1 : 0;
+            }
+        });
+        map.cells.swap(next);
+    }
+}
+
+// Inclusive bounds of an open area. x0 and y0 are always odd, walls go on even lines, gaps on odd ones.
+struct Region {
+    int x0, y0, x1, y1;
+};
+
+// Puts one wall with a gap across the region and returns the two halves, or nothing if it is too small.
+// The randomness only depends on the region, so regions can be divided in any order on any thread.
+int DivideRegion(MapWriter& writer, std::uint64_t seed, const Region& r, Region halves[2]) {
+    Rng rng(StreamSeed(seed, (std::uint64_t(r.x0) << 32) | std::uint32_t(r.y0),
+                       (std::uint64_t(r.x1) << 32) | std::uint32_t(r.y1)));
+    const int rows = (r.y1 - r.y0) / 2;  // Even lines strictly inside the region
+    const int columns = (r.x1 - r.x0) / 2;
+    bool horizontal = r.y1 - r.y0 > r.x1 - r.x0 || (r.y1 - r.y0 == r.x1 - r.x0 && rng.Below(2) == 0);
+    if (horizontal ? rows == 0 : columns == 0) {
+        horizontal = !horizontal;
+    }
+    if ((horizontal ? rows : columns) == 0) {
+        return 0;
+    }
+    if (horizontal) {
+        const int wall_y = r.y0 + 1 + 2 * rng.Below(rows);
+        const int gap_x = r.x0 + 2 * rng.Below((r.x1 - r.x0) / 2 + 1);
+        for (int x = r.x0; x <= r.x1; ++x) {
+            writer.Set(x, wall_y, x != gap_x);
+        }
+        halves[0] = Region{r.x0, r.y0, r.x1, wall_y - 1};
+        halves[1] = Region{r.x0, wall_y + 1, r.x1, r.y1};
+    } else {
+        const int wall_x = r.x0 + 1 + 2 * rng.Below(columns);
+        const int gap_y = r.y0 + 2 * rng.Below((r.y1 - r.y0) / 2 + 1);
+        for (int y = r.y0; y <= r.y1; ++y) {
+            writer.Set(wall_x, y, y != gap_y);
+        }
+        halves[0] = Region{r.x0, r.y0, wall_x - 1, r.y1};
+        halves[1] = Region{wall_x + 1, r.y0, r.x1, r.y1};
+    }
+    return 2;
+}
+
+void RecursiveDivision(GeneratedMap& map, std::uint64_t seed, unsigned workers) {
+    MapWriter writer(map);
+    ParallelFor(map.height, workers, [&](std::size_t y) {
+        const bool border = y == 0 || static_cast<int>(y) == map.height - 1;
+        writer.FillRow(static_cast<int>(y), border);
+        writer.Set(0, static_cast<int>(y), true);
+        writer.Set(map.width - 1, static_cast<int>(y), true);
+    });
+
+    // Split breadth first until there is enough independent work for every thread
+    std::deque<Region> regions{Region{1, 1, map.width - 2, map.height - 2}};
+    Region halves[2];
+    while (workers > 1 && !regions.empty() && regions.size() < workers * 8u) {
+        const int count = DivideRegion(writer, seed, regions.front(), halves);
+        regions.pop_front();
+        regions.insert(regions.end(), halves, halves + count);
+    }
+    ParallelFor(regions.size(), workers, [&](std::size_t i) {
+        std::vector<Region> stack{regions[i]};
+        Region parts[2];
+        while (!stack.empty()) {
+            const Region region = stack.back();
+            stack.pop_back();
+            const int count = DivideRegion(writer, seed, region, parts);
+            stack.insert(stack.end(), parts, parts + count);
+        }
+    });
+}
+
+// Recursive backtracker on the odd cells. Bands of rows are carved as independent mazes,
+// then every band gets one door to the band above, which keeps the whole maze a tree.
+void DfsMaze(GeneratedMap& map, std::uint64_t seed, unsigned workers) {
+    MapWriter writer(map);
+    ParallelFor(map.height, workers, [&](std::size_t y) { writer.FillRow(static_cast<int>(y), true); });
+
+    const int cells_x = (map.width - 1) / 2;
+    const int cells_y = (map.height - 1) / 2;
+    const int bands = (cells_y + kMazeBandRows - 1) / kMazeBandRows;
+    ParallelFor(bands, workers, [&](std::size_t band) {
+        const int first_row = static_cast<int>(band) * kMazeBandRows;
+        const int last_row = std::min(cells_y, first_row + kMazeBandRows) - 1;
+        Rng rng(StreamSeed(seed, band));
+        std::vector<std::uint8_t> visited(static_cast<std::size_t>(cells_x) * (last_row - first_row + 1), 0);
+        auto seen = [&](int cx, int cy) -> std::uint8_t& {
+            return visited[static_cast<std::size_t>(cy - first_row) * cells_x + cx];
+        };
+        std::vector<Coordinates> stack{Coordinates{rng.Below(cells_x), first_row}};
+        seen(stack.back().x, stack.back().y) = 1;
+        writer.Set(2 * stack.back().x + 1, 2 * stack.back().y + 1, false);
+        while (!stack.empty()) {
+            const Coordinates cell = stack.back();
+            Coordinates options[4];
+            int count = 0;
+            for (const Coordinates& dir : {Coordinates{1, 0}, Coordinates{-1, 0}, Coordinates{0, 1}, Coordinates{0, -1}}) {
+                const Coordinates next{cell.x + dir.x, cell.y + dir.y};
+                if (next.x >= 0 && next.x < cells_x && next.y >= first_row && next.y <= last_row && !seen(next.x, next.y)) {
+                    options[count++] = next;
+                }
+            }
+            if (count == 0) {
+                stack.pop_back();
+                continue;
+            }
+            const Coordinates next = options[rng.Below(count)];
+            seen(next.x, next.y) = 1;
+            writer.Set(next.x + cell.x + 1, next.y + cell.y + 1, false);  // The wall in between
+            writer.Set(2 * next.x + 1, 2 * next.y + 1, false);
+            stack.push_back(next);
+        }
+    });
+    for (int band = 1; band < bands; ++band) {
+        Rng rng(StreamSeed(seed, band, 1));
+        writer.Set(2 * rng.Below(cells_x) + 1, 2 * band * kMazeBandRows, false);
+    }
+}
+
+void Rooms(GeneratedMap& map, std::uint64_t seed, unsigned workers) {
+    MapWriter writer(map);
+    ParallelFor(map.height, workers, [&](std::size_t y) { writer.FillRow(static_cast<int>(y), true); });
+    if (map.width < 5 || map.height < 5) {
+        writer.FillRect(1, 1, map.width - 2, map.height - 2, false);
+        return;
+    }
+
+    Rng rng(StreamSeed(seed, 0));
+    const int max_w = std::clamp(map.width / 4, 3, 16);
+    const int max_h = std::clamp(map.height / 4, 3, 12);
+    const std::size_t wanted = std::max<std::size_t>(2, static_cast<std::size_t>(map.width) * map.height / 250);
+    std::vector<Region> rooms;
+    for (std::size_t attempt = 0; attempt < wanted * 4 && rooms.size() < wanted; ++attempt) {
+        const int w = rng.Between(3, std::min(max_w, map.width - 2));
+        const int h = rng.Between(3, std::min(max_h, map.height - 2));
+        const int x0 = rng.Between(1, map.width - 1 - w);
+        const int y0 = rng.Between(1, map.height - 1 - h);
+        // Only rooms are carved so far, so any free cell in the margin means an overlap.
+        // The margin keeps a wall between rooms so that they stay recognisable.
+        bool overlaps = false;
+        for (int y = y0 - 1; y <= y0 + h && !overlaps; ++y) {
+            for (int x = x0 - 1; x <= x0 + w && !overlaps; ++x) {
+                overlaps = !map.IsObstacle(x, y);
+            }
+        }
+        if (!overlaps) {
+            writer.FillRect(x0, y0, x0 + w - 1, y0 + h - 1, false);
+            rooms.push_back(Region{x0, y0, x0 + w - 1, y0 + h - 1});
+        }
+    }
+
+    // Visit the rooms in serpentine bands so that corridors stay short on big maps
+    const int band_height = 2 * max_h;
+    std::sort(rooms.begin(), rooms.end(), [band_height](const Region& a, const Region& b) {
+        const int band_a = a.y0 / band_height, band_b = b.y0 / band_height;
+        if (band_a != band_b) {
+            return band_a < band_b;
+        }
+        return band_a % 2 == 0 ? a.x0 < b.x0 : a.x0 > b.x0;
+    });
+    for (std::size_t i = 1; i < rooms.size(); ++i) {
+        // L-shaped corridor between the centres of consecutive rooms
+        const Region& prev = rooms[i - 1];
+        const Region& room = rooms[i];
+        const int ax = (prev.x0 + prev.x1) / 2, ay = (prev.y0 + prev.y1) / 2;
+        const int bx = (room.x0 + room.x1) / 2, by = (room.y0 + room.y1) / 2;
+        const int corner_x = rng.Below(2) ? ax : bx;
+        const int corner_y = corner_x == ax ? by : ay;
+        writer.FillRect(std::min(ax, corner_x), std::min(ay, corner_y), std::max(ax, corner_x), std::max(ay, corner_y), false);
+        writer.FillRect(std::min(bx, corner_x), std::min(by, corner_y), std::max(bx, corner_x), std::max(by, corner_y), false);
+    }
+}
+
+// First free cell from the top left and from the bottom right, freeing corners if there is none
+void PickEndpoints(GeneratedMap& map) {
+    const auto first = std::find(map.cells.begin(), map.cells.end(), 0);
+    const auto last = std::find(map.cells.rbegin(), map.cells.rend(), 0);
+    std::size_t start = first != map.cells.end() ? first - map.cells.begin() : 0;
+    std::size_t goal = last != map.cells.rend() ? map.cells.rend() - last - 1 : map.cells.size() - 1;
+    if (start == goal) {
+        goal = start == map.cells.size() - 1 ? 0 : map.cells.size() - 1;
+    }
+    map.cells[start] = 0;
+    map.cells[goal] = 0;
+    map.start = Coordinates{static_cast<int>(start % map.width), static_cast<int>(start / map.width)};
+    map.goal = Coordinates{static_cast<int>(goal % map.width), static_cast<int>(goal / map.width)};
+}
+
+}  // namespace
+
+const char* MapGeneratorName(MapGenerator generator) {
+    switch (generator) {
+        case MapGenerator::kRandomFill:
+            return "random";
+        case MapGenerator::kRecursiveDivision:
+            return "division";
+        case MapGenerator::kDfsMaze:
+            return "maze";
+        case MapGenerator::kRooms:
+            return "rooms";
+        default:
+            return "cave";
+    }
+}
+
+OccupancyGrid GeneratedMap::ToOccupancyGrid() const {
+    OccupancyGrid grid(width, height);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            grid.SetObstacle(x, y, IsObstacle(x, y));
+        }
+    }
+    return grid;
+}
+
+GeneratedMap GenerateMap(MapGenerator generator, int width, int height, std::uint64_t seed, double density) {
+    if (width < 3 || height < 3) {
+        throw std::invalid_argument("generated maps need at least 3x3 cells");
+    }
+    GeneratedMap map;
+    map.width = width;
+    map.height = height;
+    map.cells.resize(static_cast<std::size_t>(width) * height);
+    const unsigned workers = WorkerCount(map);
+    switch (generator) {
+        case MapGenerator::kRandomFill:
+            RandomFill(map, seed, density < 0.0 ? kDefaultFillDensity : density, workers);
+            break;
+        case MapGenerator::kRecursiveDivision:
+            RecursiveDivision(map, seed, workers);
+            break;
+        case MapGenerator::kDfsMaze:
+            DfsMaze(map, seed, workers);
+            break;
+        case MapGenerator::kRooms:
+            Rooms(map, seed, workers);
+            break;
+        case MapGenerator::kCave:
+            Cave(map, seed, density < 0.0 ? kDefaultCaveDensity : density, workers);
+            break;
+    }
+    PickEndpoints(map);
+    return map;
+}
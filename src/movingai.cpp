@@ -0,0 +1,83 @@
+#include "movingai.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+std::ifstream OpenOrThrow(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("can't open " + path);
+    }
+    return file;
+}
+
+bool IsPassable(char c) {
+    return c == '.' || c == 'G' || c == 'S';
+}
+
+}  // namespace
+
+OccupancyGrid LoadMovingAiMap(const std::string& path) {
+    std::ifstream file = OpenOrThrow(path);
+    int width = -1, height = -1;
+    std::string key;
+    // Header: "type octile", "height H", "width W", "map" in any order until "map"
+    while (file >> key && key != "map") {
+        if (key == "height") {
+            file >> height;
+        } else if (key == "width") {
+            file >> width;
+        } else {
+            std::string ignored;
+            file >> ignored;
+        }
+    }
+    if (key != "map" || width <= 0 || height <= 0) {
+        throw std::runtime_error(path + ": missing or invalid map header");
+    }
+
+    OccupancyGrid grid(width, height);
+    std::string row;
+    std::getline(file, row);  // Rest of the "map" line
+    for (int y = 0; y < height; ++y) {
+        if (!std::getline(file, row) || static_cast<int>(row.size()) < width) {
+            throw std::runtime_error(path + ": row " + std::to_string(y) + " is missing or too short");
+        }
+        for (int x = 0; x < width; ++x) {
+            if (!IsPassable(row[x])) {
+                grid.SetObstacle(x, y, true);
+            }
+        }
+    }
+    return grid;
+}
+
+std::vector<MovingAiScenario> LoadMovingAiScenarios(const std::string& path) {
+    std::ifstream file = OpenOrThrow(path);
+    std::vector<MovingAiScenario> scenarios;
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)) {
+        ++line_number;
+        if (line.empty() || line.rfind("version", 0) == 0) {
+            continue;
+        }
+        // Fields are tab separated, but map names never contain whitespace
+        std::istringstream fields(line);
+        MovingAiScenario s;
+        if (!(fields >> s.bucket >> s.map >> s.map_width >> s.map_height >> s.start.x >> s.start.y >> s.goal.x >>
+              s.goal.y >> s.optimal_length)) {
+            throw std::runtime_error(path + ":" + std::to_string(line_number) + ": malformed scenario");
+        }
+        // The searches index their tables with these, so they have to lie on the map
+        auto on_map = [&s](Coordinates at) { return 0 <= at.x && at.x < s.map_width && 0 <= at.y && at.y < s.map_height; };
+        if (!on_map(s.start) || !on_map(s.goal)) {
+            throw std::runtime_error(path + ":" + std::to_string(line_number) + ": start or goal outside the map");
+        }
+        scenarios.push_back(s);
+    }
+    return scenarios;
+}
@@ -0,0 +1,225 @@
+#include "perf_counters.hpp"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cstring>
+#endif
+
+const char* PerfSourceName(PerfSource source) {
+    switch (source) {
+        case PerfSource::kHardware:
+            return "hardware";
+        case PerfSource::kSoftware:
+            return "software";
+        case PerfSource::kRusage:
+            return "rusage";
+        default:
+            return "none";
+    }
+}
+
+PerfCounts& PerfCounts::operator+=(const PerfCounts& other) {
+    source = other.source;
+    instructions += other.instructions;
+    cycles += other.cycles;
+    cache_misses += other.cache_misses;
+    branch_misses += other.branch_misses;
+    task_clock_ns += other.task_clock_ns;
+    page_faults += other.page_faults;
+    context_switches += other.context_switches;
+    return *this;
+}
+
+namespace {
+
+#ifdef __linux__
+// Opens one event of the calling thread on any CPU, disabled if it leads a group. Returns -1 on failure.
+int OpenEvent(std::uint32_t type, std::uint64_t config, int group_fd, bool user_only, std::uint64_t read_format) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = group_fd == -1;
+    attr.exclude_kernel = user_only;
+    attr.exclude_hv = 1;
+    attr.read_format = read_format;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+
+// Opens all events as one group, or none of them
+template <std::size_t N>
+bool OpenGroup(std::array<int, N>& fds, std::uint32_t type, const std::array<std::uint64_t, N>& configs, bool user_only,
+               std::uint64_t read_format) {
+    fds.fill(-1);
+    for (std::size_t i = 0; i < N; ++i) {
+        fds[i] = OpenEvent(type, configs[i], i == 0 ? -1 : fds[0], user_only, read_format);
+        if (fds[i] == -1) {
+            for (int& fd : fds) {
+                if (fd != -1) {
+                    close(fd);
+                    fd = -1;
+                }
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+// Task clock, page faults and context switches of the calling thread so far
+std::array<std::uint64_t, 3> SampleThreadUsage() {
+    rusage usage;
+    timespec clock;
+    getrusage(RUSAGE_THREAD, &usage);
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &clock);
+    return {static_cast<std::uint64_t>(clock.tv_sec) * 1000000000 + static_cast<std::uint64_t>(clock.tv_nsec),
+            static_cast<std::uint64_t>(usage.ru_minflt + usage.ru_majflt),
+            static_cast<std::uint64_t>(usage.ru_nvcsw + usage.ru_nivcsw)};
+}
+
+void SetGroupEnabled(int leader, bool enabled) {
+    if (leader != -1) {
+        ioctl(leader, enabled ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+constexpr std::uint64_t kHardwareReadFormat =
+    PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+constexpr std::uint64_t kSoftwareReadFormat = PERF_FORMAT_GROUP;
+#endif
+
+}  // namespace
+
+PerfCounters::PerfCounters() : source_(PerfSource::kNone), running_(false) {
+    hardware_fds_.fill(-1);
+    software_fds_.fill(-1);
+#ifdef __linux__
+    // Context switches happen in the kernel, so the software group has to count kernel time as well
+    if (OpenGroup(software_fds_, PERF_TYPE_SOFTWARE,
+                  {PERF_COUNT_SW_TASK_CLOCK, PERF_COUNT_SW_PAGE_FAULTS, PERF_COUNT_SW_CONTEXT_SWITCHES}, false,
+                  kSoftwareReadFormat)) {
+        source_ = PerfSource::kSoftware;
+        if (OpenGroup(hardware_fds_, PERF_TYPE_HARDWARE,
+                      {PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_CACHE_MISSES,
+                       PERF_COUNT_HW_BRANCH_MISSES},
+                      true, kHardwareReadFormat)) {
+            source_ = PerfSource::kHardware;
+        }
+    } else {
+        source_ = PerfSource::kRusage;
+    }
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+    for (int fd : hardware_fds_) {
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+    for (int fd : software_fds_) {
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+#endif
+}
+
+PerfCounters::Raw PerfCounters::ReadRaw() const {
+    Raw raw;
+#ifdef __linux__
+    if (source_ == PerfSource::kRusage) {
+        // Only what happened while resumed counts, like with the perf events
+        raw = paused_;
+        if (running_) {
+            const auto usage = SampleThreadUsage();
+            for (int i = 0; i < kSoftwareEvents; ++i) {
+                raw.software[i] += usage[i] - resumed_at_.software[i];
+            }
+        }
+        return raw;
+    }
+    if (software_fds_[0] != -1) {
+        std::uint64_t values[1 + kSoftwareEvents] = {};
+        if (read(software_fds_[0], values, sizeof(values)) == static_cast<ssize_t>(sizeof(values))) {
+            for (int i = 0; i < kSoftwareEvents; ++i) {
+                raw.software[i] = values[1 + i];
+            }
+        }
+    }
+    if (hardware_fds_[0] != -1) {
+        std::uint64_t values[3 + kHardwareEvents] = {};
+        if (read(hardware_fds_[0], values, sizeof(values)) == static_cast<ssize_t>(sizeof(values))) {
+            raw.hardware_enabled = values[1];
+            raw.hardware_running = values[2];
+            for (int i = 0; i < kHardwareEvents; ++i) {
+                raw.hardware[i] = values[3 + i];
+            }
+        }
+    }
+#endif
+    return raw;
+}
+
+void PerfCounters::Reset() {
+    baseline_ = ReadRaw();
+}
+
+void PerfCounters::Resume() {
+    if (running_) {
+        return;
+    }
+#ifdef __linux__
+    if (source_ == PerfSource::kRusage) {
+        resumed_at_.software = SampleThreadUsage();
+    }
+    SetGroupEnabled(software_fds_[0], true);
+    SetGroupEnabled(hardware_fds_[0], true);
+#endif
+    running_ = true;
+}
+
+void PerfCounters::Pause() {
+    if (!running_) {
+        return;
+    }
+#ifdef __linux__
+    SetGroupEnabled(hardware_fds_[0], false);
+    SetGroupEnabled(software_fds_[0], false);
+    if (source_ == PerfSource::kRusage) {
+        paused_ = ReadRaw();
+    }
+#endif
+    running_ = false;
+}
+
+PerfCounts PerfCounters::Read() const {
+    const Raw now = ReadRaw();
+    PerfCounts counts;
+    counts.source = source_;
+    counts.task_clock_ns = now.software[0] - baseline_.software[0];
+    counts.page_faults = now.software[1] - baseline_.software[1];
+    counts.context_switches = now.software[2] - baseline_.software[2];
+    if (source_ == PerfSource::kHardware) {
+        // The kernel multiplexes groups that don't fit the PMU, scale up to the time the group was enabled
+        const std::uint64_t enabled = now.hardware_enabled - baseline_.hardware_enabled;
+        const std::uint64_t running = now.hardware_running - baseline_.hardware_running;
+        const double scale = running > 0 ? static_cast<double>(enabled) / static_cast<double>(running) : 0.0;
+        auto scaled = [&](int i) {
+            return static_cast<std::uint64_t>(static_cast<double>(now.hardware[i] - baseline_.hardware[i]) * scale);
+        };
+        counts.instructions = scaled(0);
+        counts.cycles = scaled(1);
+        counts.cache_misses = scaled(2);
+        counts.branch_misses = scaled(3);
+    }
+    return counts;
+}
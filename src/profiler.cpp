@@ -0,0 +1,190 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+std::atomic<bool> g_profiler_enabled{false};
+
+namespace {
+
+struct ZoneRecord {
+    const char* name;
+    std::uint64_t begin_ns;
+    std::uint64_t end_ns;
+    std::uint32_t depth;  // 1 for a zone without an enclosing one
+};
+
+// Ring buffer of one thread. Only the owner writes, the mutex is there for the dump and never contended otherwise.
+struct ThreadBuffer {
+    std::mutex mutex;
+    std::vector<ZoneRecord> records;
+    std::size_t next = 0;  // Slot the next record goes to once the ring is full
+    std::uint32_t thread_index = 0;
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;  // Shared so records outlive their thread
+};
+
+Registry& GetRegistry() {
+    static Registry registry;
+    return registry;
+}
+
+thread_local std::shared_ptr<ThreadBuffer> t_buffer;
+thread_local std::uint32_t t_depth = 0;
+
+std::uint64_t NowNs() {
+    static const auto epoch = std::chrono::steady_clock::now();
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count());
+}
+
+ThreadBuffer& LocalBuffer() {
+    if (!t_buffer) {
+        auto buffer = std::make_shared<ThreadBuffer>();
+        buffer->records.reserve(kProfileBufferZones);
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        buffer->thread_index = static_cast<std::uint32_t>(registry.buffers.size()) + 1;
+        registry.buffers.push_back(buffer);
+        t_buffer = std::move(buffer);
+    }
+    return *t_buffer;
+}
+
+struct ThreadRecords {
+    std::uint32_t thread_index;
+    std::vector<ZoneRecord> records;  // Sorted by start, enclosing zones first
+};
+
+std::vector<ThreadRecords> CollectRecords() {
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        buffers = registry.buffers;
+    }
+    std::vector<ThreadRecords> threads;
+    for (const auto& buffer : buffers) {
+        ThreadRecords thread{buffer->thread_index, {}};
+        {
+            std::lock_guard<std::mutex> lock(buffer->mutex);
+            thread.records = buffer->records;
+        }
+        std::sort(thread.records.begin(), thread.records.end(), [](const ZoneRecord& a, const ZoneRecord& b) {
+            return a.begin_ns != b.begin_ns ? a.begin_ns < b.begin_ns : a.depth < b.depth;
+        });
+        threads.push_back(std::move(thread));
+    }
+    return threads;
+}
+
+std::ofstream OpenOutput(const std::string& path) {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("can't create " + path);
+    }
+    return file;
+}
+
+void CloseOutput(std::ofstream& file, const std::string& path) {
+    file.close();
+    if (!file) {
+        throw std::runtime_error("can't write " + path);
+    }
+}
+
+}  // namespace
+
+void SetProfilerEnabled(bool enabled) {
+    NowNs();  // Pins the epoch before the first zone
+    g_profiler_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void ProfileZone::Open(const char* name) {
+    name_ = name;
+    depth_ = ++t_depth;
+    begin_ns_ = NowNs();
+}
+
+void ProfileZone::Close() {
+    const std::uint64_t end_ns = NowNs();
+    --t_depth;
+    ThreadBuffer& buffer = LocalBuffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    const ZoneRecord record{name_, begin_ns_, end_ns, depth_};
+    if (buffer.records.size() < kProfileBufferZones) {
+        buffer.records.push_back(record);
+    } else {
+        buffer.records[buffer.next] = record;
+        buffer.next = (buffer.next + 1) % kProfileBufferZones;
+    }
+}
+
+void WriteChromeTrace(const std::string& path) {
+    std::ofstream file = OpenOutput(path);
+    file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    bool first = true;
+    char line[256];
+    for (const auto& thread : CollectRecords()) {
+        for (const auto& record : thread.records) {
+            std::snprintf(line, sizeof(line), "%s{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}",
+                          first ? "" : ",\n", record.name, thread.thread_index, record.begin_ns / 1000.0,
+                          (record.end_ns - record.begin_ns) / 1000.0);
+            file << line;
+            first = false;
+        }
+    }
+    file << "\n]}\n";
+    CloseOutput(file, path);
+}
+
+void WriteCollapsedStacks(const std::string& path) {
+    // Self time per call stack, the stacks are rebuilt from the nesting depth of the sorted zones
+    std::map<std::string, std::uint64_t> self_ns;
+    struct Open {
+        const ZoneRecord* record;
+        std::string stack;
+        std::uint64_t children_ns;
+    };
+    for (const auto& thread : CollectRecords()) {
+        std::vector<Open> open;
+        const auto close_top = [&] {
+            const Open& top = open.back();
+            const std::uint64_t duration = top.record->end_ns - top.record->begin_ns;
+            self_ns[top.stack] += duration - std::min(duration, top.children_ns);
+            open.pop_back();
+            if (!open.empty()) {
+                open.back().children_ns += duration;
+            }
+        };
+        for (const auto& record : thread.records) {
+            while (!open.empty() && (open.back().record->depth >= record.depth || open.back().record->end_ns <= record.begin_ns)) {
+                close_top();
+            }
+            std::string stack = open.empty() ? std::string(record.name) : open.back().stack + ";" + record.name;
+            open.push_back(Open{&record, std::move(stack), 0});
+        }
+        while (!open.empty()) {
+            close_top();
+        }
+    }
+
+    std::ofstream file = OpenOutput(path);
+    for (const auto& [stack, ns] : self_ns) {
+        const std::uint64_t micros = ns / 1000;
+        if (micros > 0) {
+            file << stack << ' ' << micros << '\n';
+        }
+    }
+    CloseOutput(file, path);
+}
@@ -1,69 +1,118 @@
 #include "search.hpp"
 
 #include <algorithm>
+#include <limits>
 
-bool Search::InBounds(Coordinates& id, std::vector<std::vector<Tile>>& grid) const {
-    return 0 <= id.x && id.x < grid[0].size() && 0 <= id.y && id.y < grid.size();
+#include "profiler.hpp"
+
+const char* AlgorithmName(Algorithm algorithm) {
+    switch (algorithm) {
+        case Algorithm::kBfs:
+            return "bfs";
+        case Algorithm::kDijkstra:
+            return "dijkstra";
+        default:
+            return "astar";
+    }
+}
+
+void CancelToken::Cancel() const {
+    {
+        // Setting the flag under the lock keeps SleepFor from missing the wake-up
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        state_->cancelled.store(true, std::memory_order_relaxed);
+    }
+    state_->cv.notify_all();
+}
+
+bool CancelToken::SleepFor(std::chrono::milliseconds duration) const {
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    return !state_->cv.wait_for(lock, duration, [this] { return IsCancelled(); });
+}
+
+template <typename Grid, typename Layout>
+bool BasicSearch<Grid, Layout>::InBounds(Coordinates& id) const {
+    return 0 <= id.x && id.x < grid_.Width() && 0 <= id.y && id.y < grid_.Height();
 }
 
-bool Search::Passable(Coordinates& id) const {
-    return obstacles_.find(id) == obstacles_.end();
+template <typename Grid, typename Layout>
+bool BasicSearch<Grid, Layout>::Passable(Coordinates& id) const {
+    return !grid_.IsObstacle(id.x, id.y);
 }
 
-std::vector<Coordinates> Search::Neighbors(Coordinates& id, std::vector<std::vector<Tile>>& grid) const {
-    std::vector<Coordinates> ret;
+template <typename Grid, typename Layout>
+NeighborList BasicSearch<Grid, Layout>::Neighbors(Coordinates& id) const {
+    NeighborList ret;
     for (const auto& dir : delta_) {
         Coordinates next{id.x + dir.x, id.y + dir.y};
-        if (InBounds(next, grid) && Passable(next)) {
-            ret.push_back(next);
+        if (InBounds(next) && Passable(next)) {
+            ret.cells[ret.count++] = next;
         }
     }
     // Nudge directions for "prettier" paths
     if ((id.x + id.y) % 2 == 0) {
-        std::reverse(ret.begin(), ret.end());
+        std::reverse(ret.cells.begin(), ret.cells.begin() + ret.count);
     }
     return ret;
 }
 
-std::string Search::GetVector(Coordinates& current, Coordinates& from) {
-    if (from.x > current.x) {
-        return "A";  // Right arrow
-    } else if (from.x < current.x) {
-        return "B";  // Left arrow
-    } else if (from.y > current.y) {
-        return "D";  // Up arrow
-    } else {
-        return "C";  // Down arrow
-    }
+template <typename Grid, typename Layout>
+char BasicSearch<Grid, Layout>::GetVector(Direction to_parent) {
+    // Arrows of the icon font, pointing to where the cell was reached from
+    constexpr char kArrows[] = {
+        'A',  // Right arrow
+        'B',  // Left arrow
+        'C',  // Down arrow, the parent is above on screen
+        'D'   // Up arrow
+    };
+    return kArrows[static_cast<int>(to_parent)];
 }
 
-void Search::CollectObstacles(const std::vector<std::vector<Tile>>& grid) {
-    for (const auto& row : grid) {
-        for (const auto& col : row) {
-            if (col.IsTileObstacle()) {
-                obstacles_.insert(Coordinates{col.x, col.y});
-            }
+template <typename Grid, typename Layout>
+bool BasicSearch<Grid, Layout>::Emit(SearchChannel& channel, SearchEvent event) {
+    event.job_id = channel.job_id;
+    // The GUI drains the queue every frame, so a full queue only means we are ahead of it
+    while (!channel.events.TryPush(event)) {
+        if (channel.token.IsCancelled()) {
+            return false;
         }
+        std::this_thread::yield();
     }
+    return true;
 }
 
-void Search::SetPath(std::vector<std::vector<Tile>>& grid, const Tile* start_ptr, Tile* goal_ptr) {
-    std::vector<Coordinates> path;
-    Coordinates current{goal_ptr->x, goal_ptr->y};
-    Coordinates start{start_ptr->x, start_ptr->y};
-    while (current != start) {
-        path.push_back(current);
-        current = came_from_[current];
+template <typename Grid, typename Layout>
+void BasicSearch<Grid, Layout>::PushEvent(std::vector<SearchEvent>& events, SearchEventType type, Coordinates at,
+                                  char arrow) const {
+    if (!emit_events_) {
+        return;
     }
-    auto rit = path.rbegin();
-    for (; rit != path.rend(); ++rit) {
-        grid[rit->y][rit->x].SetTilePath();
-        goal_ptr->SetTileGoal();
-        std::this_thread::sleep_for(std::chrono::milliseconds(40));
+    events.push_back(SearchEvent{type, at, arrow, 0, grid_.Version()});
+}
+
+template <typename Grid, typename Layout>
+void BasicSearch<Grid, Layout>::SetPath() {
+    PROFILE_ZONE("Search::SetPath");
+    const auto begin = std::chrono::steady_clock::now();
+    std::vector<Coordinates>& path = workspace_.Path();
+    path.clear();
+    double cost = 0.0;
+    Coordinates current = goal_;
+    // Each step back is a 2-bit direction to the parent
+    while (current != start_) {
+        path.push_back(current);
+        Coordinates previous = workspace_.Parent(current);
+        cost += Cost(previous, current);
+        current = previous;
     }
+    path_revealed_ = 0;
+    stats_.path_length = path.size();
+    stats_.path_cost = cost;
+    stats_.reconstruction_time += std::chrono::steady_clock::now() - begin;
 }
 
-double Search::Cost(Coordinates& from_node, Coordinates& to_node) const {
+template <typename Grid, typename Layout>
+double BasicSearch<Grid, Layout>::Cost(Coordinates& from_node, Coordinates& to_node) const {
     bool nudge = false;
     int x1 = from_node.x, y1 = from_node.y;
     int x2 = to_node.x, y2 = to_node.y;
@@ -72,120 +121,314 @@ double Search::Cost(Coordinates& from_node, Coordinates& to_node) const {
     return nudge ? 1.001 : 1;
 }
 
-double Search::Heuristic(const Coordinates& a, const Coordinates& b) {
+template <typename Grid, typename Layout>
+double BasicSearch<Grid, Layout>::Heuristic(const Coordinates& a, const Coordinates& b) {
     return std::abs(b.x - a.x) + std::abs(b.y - a.y);
 }
 
-void Search::Bfs(std::vector<std::vector<Tile>>& grid, Tile* start_ptr, Tile* goal_ptr, bool& gui_busy) {
-    // Lock GUI inputs
-    gui_busy = true;
-    CollectObstacles(grid);
+template <typename Grid, typename Layout>
+void BasicSearch<Grid, Layout>::Begin(Algorithm algorithm, Grid grid, Coordinates start, Coordinates goal) {
+    PROFILE_ZONE("Search::Begin");
+    const AllocCounts allocations_before = ThreadAllocCounts();
+    if (perf_counters_ != nullptr) {
+        perf_counters_->Reset();
+        perf_counters_->Resume();
+    }
+    const auto begin = std::chrono::steady_clock::now();
+    const bool reuse = CanReuseTree(algorithm, grid, start);
+    if (reuse) {
+        ReuseTree(goal);
+    }
+    algorithm_ = algorithm;
+    grid_ = std::move(grid);
+    start_ = start;
+    goal_ = goal;
+    path_found_ = false;
+    stats_ = SearchStats();
+    stats_.resumed = reuse;
+    path_revealed_ = 0;
+    workspace_.Path().clear();
 
-    std::queue<Coordinates> frontier;
-    frontier.push(Coordinates{start_ptr->x, start_ptr->y});
-    came_from_[Coordinates{start_ptr->x, start_ptr->y}] = Coordinates{start_ptr->x, start_ptr->y};
+    if (reuse) {
+        // A settled goal already has its final parent chain
+        if (IsSettled(goal_)) {
+            SetPath();
+            phase_ = Phase::kPath;
+        } else {
+            phase_ = Phase::kSearching;
+        }
+    } else {
+        workspace_.Begin(grid_.Width(), grid_.Height(), algorithm_ == Algorithm::kBfs);
+        goal_popped_ = false;
+        settled_cost_ = -1;
+        counters_.width = count_cells_ ? grid_.Width() : 0;
+        counters_.height = count_cells_ ? grid_.Height() : 0;
+        const std::size_t counted = static_cast<std::size_t>(counters_.width) * counters_.height;
+        counters_.expansions.assign(counted, 0);
+        counters_.pushes.assign(counted, 0);
 
-    while (!frontier.empty()) {
-        Coordinates current = frontier.front();
-        frontier.pop();
-        if (current == Coordinates{goal_ptr->x, goal_ptr->y}) {
-            SetPath(grid, start_ptr, goal_ptr);
-            break;
+        // The start has no parent, path reconstruction stops there before reading its direction
+        if (algorithm_ == Algorithm::kBfs) {
+            workspace_.Reach(start, Direction::kEast);
+            workspace_.PushQueue(start);
+            CountCell(counters_.pushes, start);
+            stats_.frontier_peak = 1;
+        } else {
+            workspace_.Reach(start, Direction::kEast, 0);
+            PushFrontier(start, 0);
         }
-        for (Coordinates next : Neighbors(current, grid)) {
-            if (came_from_.find(next) == came_from_.end()) {
-                frontier.push(next);
-                came_from_[next] = current;
-                if (grid[next.y][next.x].IsTileGoal()) {
-                    goal_ptr->SetTileGoal();
-                } else {
-                    grid[next.y][next.x].SetTileVisited();
-                    grid[next.y][next.x].text = GetVector(next, current);
-                }
-                std::this_thread::sleep_for(std::chrono::milliseconds(3));
-            }
+        phase_ = Phase::kSearching;
+    }
+    stats_.setup_time = std::chrono::steady_clock::now() - begin;
+    stats_.allocations = ThreadAllocCounts() - allocations_before;
+    if (perf_counters_ != nullptr) {
+        perf_counters_->Pause();
+        stats_.perf = perf_counters_->Read();
+    }
+}
+
+template <typename Grid, typename Layout>
+bool BasicSearch<Grid, Layout>::CanReuseTree(Algorithm algorithm, const Grid& grid, Coordinates start) const {
+    // The counters have to be there exactly when the new query counts
+    return reuse_tree_ && phase_ != Phase::kIdle && algorithm != Algorithm::kAStar && algorithm == algorithm_ &&
+           start == start_ && grid.Version() == grid_.Version() && grid.Width() == grid_.Width() &&
+           grid.Height() == grid_.Height() && count_cells_ != counters_.IsEmpty();
+}
+
+template <typename Grid, typename Layout>
+void BasicSearch<Grid, Layout>::ReuseTree(Coordinates goal) {
+    PROFILE_ZONE("Search::ReuseTree");
+    // The previous goal was popped but not expanded, it goes back so the tree grows on from it
+    if (goal_popped_ && goal != goal_) {
+        if (algorithm_ == Algorithm::kBfs) {
+            workspace_.UnpopQueue();
+        } else {
+            PushFrontier(goal_, workspace_.Cost(goal_));
         }
+        goal_popped_ = false;
     }
-    // Release GUI processing
-    gui_busy = false;
 }
 
-void Search::Dijkstra(std::vector<std::vector<Tile>>& grid, Tile* start_ptr, Tile* goal_ptr, bool& gui_busy) {
-    // Lock GUI inputs
-    gui_busy = true;
-    CollectObstacles(grid);
+template <typename Grid, typename Layout>
+bool BasicSearch<Grid, Layout>::IsSettled(Coordinates at) {
+    if (!workspace_.IsReached(at)) {
+        return false;
+    }
+    // A BFS parent is final once the cell is reached. Dijkstra pops in order of cost, so a reached cell is final
+    // if nothing left on the frontier is cheaper.
+    return algorithm_ == Algorithm::kBfs || workspace_.Frontier().empty() || workspace_.Cost(at) <= settled_cost_;
+}
 
-    std::vector<std::pair<Coordinates, double>> frontier;
-    frontier.emplace_back(std::make_pair(Coordinates{start_ptr->x, start_ptr->y}, 0));
+template <typename Grid, typename Layout>
+std::size_t BasicSearch<Grid, Layout>::Step(std::size_t n, std::vector<SearchEvent>& events) {
+    PROFILE_ZONE("Search::Step");
+    const AllocCounts allocations_before = ThreadAllocCounts();
+    if (perf_counters_ != nullptr) {
+        perf_counters_->Resume();
+    }
+    const auto begin = std::chrono::steady_clock::now();
+    const auto reconstruction_before = stats_.reconstruction_time;
+    std::size_t steps = 0;
+    for (; steps < n && !IsDone(); ++steps) {
+        if (phase_ == Phase::kPath) {
+            RevealPath(events);
+        } else if (algorithm_ == Algorithm::kBfs) {
+            ExpandBfs(events);
+        } else {
+            ExpandBestFirst(events);
+        }
+    }
+    // SetPath() books its own time as reconstruction
+    stats_.search_time += std::chrono::steady_clock::now() - begin - (stats_.reconstruction_time - reconstruction_before);
+    stats_.allocations += ThreadAllocCounts() - allocations_before;
+    if (perf_counters_ != nullptr) {
+        perf_counters_->Pause();
+        stats_.perf = perf_counters_->Read();
+    }
+    return steps;
+}
 
-    came_from_[Coordinates{start_ptr->x, start_ptr->y}] = Coordinates{start_ptr->x, start_ptr->y};
-    cost_so_far_[Coordinates{start_ptr->x, start_ptr->y}] = 0;
+template <typename Grid, typename Layout>
+std::size_t BasicSearch<Grid, Layout>::RunFor(std::chrono::microseconds budget, std::size_t max_steps,
+                                      std::vector<SearchEvent>& events) {
+    const auto deadline = std::chrono::steady_clock::now() + budget;
+    std::size_t steps = 0;
+    while (steps < max_steps && !IsDone() && std::chrono::steady_clock::now() < deadline) {
+        steps += Step(1, events);
+    }
+    return steps;
+}
 
-    while (!frontier.empty()) {
-        std::sort(frontier.begin(), frontier.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
-        Coordinates current = frontier.back().first;
-        frontier.pop_back();
+template <typename Grid, typename Layout>
+SearchStats BasicSearch<Grid, Layout>::Run(std::vector<SearchEvent>& events) {
+    Step(std::numeric_limits<std::size_t>::max(), events);
+    return stats_;
+}
 
-        if (current == Coordinates{goal_ptr->x, goal_ptr->y}) {
-            SetPath(grid, start_ptr, goal_ptr);
-            break;
+template <typename Grid, typename Layout>
+Generator<SearchEvent> BasicSearch<Grid, Layout>::Events(Algorithm algorithm, Grid grid, Coordinates start, Coordinates goal) {
+    Begin(algorithm, std::move(grid), start, goal);
+    std::vector<SearchEvent> events;
+    while (!IsDone()) {
+        events.clear();
+        Step(1, events);
+        for (const auto& event : events) {
+            co_yield event;
         }
-        for (Coordinates next : Neighbors(current, grid)) {
-            double new_cost = cost_so_far_[current] + Cost(current, next);
-            if (cost_so_far_.find(next) == cost_so_far_.end() || new_cost < cost_so_far_[next]) {
-                cost_so_far_[next] = new_cost;
-                came_from_[next] = current;
-                frontier.push_back(std::make_pair(next, new_cost));
-                if (grid[next.y][next.x].IsTileGoal()) {
-                    goal_ptr->SetTileGoal();
-                } else {
-                    grid[next.y][next.x].SetTileVisited();
-                    grid[next.y][next.x].text = GetVector(next, current);
-                }
-                std::this_thread::sleep_for(std::chrono::milliseconds(3));
+    }
+}
+
+template <typename Grid, typename Layout>
+void BasicSearch<Grid, Layout>::Play(SearchChannel& channel) {
+    const auto visit_delay = std::chrono::milliseconds(algorithm_ == Algorithm::kAStar ? 6 : 3);
+    const auto path_delay = std::chrono::milliseconds(40);
+    std::vector<SearchEvent> events;
+    while (!IsDone()) {
+        if (channel.token.IsCancelled()) {
+            return;
+        }
+        events.clear();
+        Step(1, events);
+        if (channel.progress != nullptr) {
+            channel.progress->nodes_expanded.store(stats_.nodes_expanded, std::memory_order_relaxed);
+            channel.progress->memory_bytes.store(MemoryBytes(), std::memory_order_relaxed);
+        }
+        for (const auto& event : events) {
+            if (!Emit(channel, event)) {
+                return;
+            }
+            if (event.type == SearchEventType::kVisit && !channel.token.SleepFor(visit_delay)) {
+                return;
+            }
+            if (event.type == SearchEventType::kPath && !channel.token.SleepFor(path_delay)) {
+                return;
             }
         }
     }
-    // Release GUI processing
-    gui_busy = false;
 }
 
-void Search::AStar(std::vector<std::vector<Tile>>& grid, Tile* start_ptr, Tile* goal_ptr, bool& gui_busy) {
-    // Lock GUI inputs
-    gui_busy = true;
-    CollectObstacles(grid);
+template <typename Grid, typename Layout>
+std::size_t BasicSearch<Grid, Layout>::MemoryBytes() const {
+    return workspace_.MemoryBytes() + (counters_.expansions.capacity() + counters_.pushes.capacity()) * sizeof(std::uint32_t);
+}
 
-    std::vector<std::pair<Coordinates, double>> frontier;
-    frontier.emplace_back(std::make_pair(Coordinates{start_ptr->x, start_ptr->y}, 0));
+template <typename Grid, typename Layout>
+void BasicSearch<Grid, Layout>::Finish(std::vector<SearchEvent>& events, bool path_found) {
+    PROFILE_ZONE("Search::Finish");
+    path_found_ = path_found;
+    phase_ = Phase::kDone;
+    stats_.bytes_allocated = MemoryBytes();
+    PushEvent(events, SearchEventType::kDone, goal_);
+}
 
-    came_from_[Coordinates{start_ptr->x, start_ptr->y}] = Coordinates{start_ptr->x, start_ptr->y};
-    cost_so_far_[Coordinates{start_ptr->x, start_ptr->y}] = 0;
+template <typename Grid, typename Layout>
+void BasicSearch<Grid, Layout>::RevealPath(std::vector<SearchEvent>& events) {
+    // The path runs from the goal back to the start, reveal it the other way round
+    const std::vector<Coordinates>& path = workspace_.Path();
+    // A reused tree can hand over a goal that is the start
+    if (path.empty()) {
+        Finish(events, true);
+        return;
+    }
+    PushEvent(events, SearchEventType::kPath, path[path.size() - 1 - path_revealed_]);
+    if (++path_revealed_ == path.size()) {
+        Finish(events, true);
+    }
+}
 
-    while (!frontier.empty()) {
-        std::sort(frontier.begin(), frontier.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
-        Coordinates current = frontier.back().first;
-        frontier.pop_back();
-        if (current == Coordinates{goal_ptr->x, goal_ptr->y}) {
-            SetPath(grid, start_ptr, goal_ptr);
-            break;
+template <typename Grid, typename Layout>
+void BasicSearch<Grid, Layout>::ExpandBfs(std::vector<SearchEvent>& events) {
+    if (workspace_.IsQueueEmpty()) {
+        Finish(events, false);
+        return;
+    }
+    Coordinates current = workspace_.PopQueue();
+    ++stats_.nodes_expanded;
+    CountCell(counters_.expansions, current);
+    if (current == goal_) {
+        goal_popped_ = true;
+        SetPath();
+        phase_ = Phase::kPath;
+        if (workspace_.Path().empty()) {
+            Finish(events, true);
         }
-        for (Coordinates next : Neighbors(current, grid)) {
-            double new_cost = cost_so_far_[current] + Cost(current, next);
-            if (cost_so_far_.find(next) == cost_so_far_.end() || new_cost < cost_so_far_[next]) {
-                cost_so_far_[next] = new_cost;
-                double priority = new_cost + Heuristic(next, Coordinates{goal_ptr->x, goal_ptr->y});
-                frontier.push_back(std::make_pair(next, priority));
-                came_from_[next] = current;
-                if (grid[next.y][next.x].IsTileGoal()) {
-                    goal_ptr->SetTileGoal();
-                } else {
-                    grid[next.y][next.x].SetTileVisited();
-                    grid[next.y][next.x].text = GetVector(next, current);
-                }
-                std::this_thread::sleep_for(std::chrono::milliseconds(6));
-            }
+        return;
+    }
+    for (Coordinates next : Neighbors(current)) {
+        ++stats_.nodes_generated;
+        if (!workspace_.IsReached(next)) {
+            workspace_.PushQueue(next);
+            CountCell(counters_.pushes, next);
+            stats_.frontier_peak = std::max(stats_.frontier_peak, workspace_.QueueSize());
+            const Direction to_parent = DirectionTo(next, current);
+            workspace_.Reach(next, to_parent);
+            PushEvent(events, SearchEventType::kVisit, next, GetVector(to_parent));
+        }
+    }
+}
+
+template <typename Grid, typename Layout>
+void BasicSearch<Grid, Layout>::ExpandBestFirst(std::vector<SearchEvent>& events) {
+    if (workspace_.Frontier().empty()) {
+        Finish(events, false);
+        return;
+    }
+    auto [current, priority] = PopFrontier();
+    settled_cost_ = priority;
+    ++stats_.nodes_expanded;
+    CountCell(counters_.expansions, current);
+    // A cheaper entry of the same node had a lower priority and came out first
+    const double current_cost = workspace_.Cost(current);
+    if (priority > Priority(current, current_cost)) {
+        ++stats_.re_expansions;
+    }
+    if (current == goal_) {
+        goal_popped_ = true;
+        SetPath();
+        phase_ = Phase::kPath;
+        if (workspace_.Path().empty()) {
+            Finish(events, true);
+        }
+        return;
+    }
+    for (Coordinates next : Neighbors(current)) {
+        ++stats_.nodes_generated;
+        double new_cost = current_cost + Cost(current, next);
+        const bool reached = workspace_.IsReached(next);
+        if (!reached || new_cost < workspace_.Cost(next)) {
+            stats_.duplicate_pushes += reached;
+            const Direction to_parent = DirectionTo(next, current);
+            workspace_.Reach(next, to_parent, new_cost);
+            PushFrontier(next, Priority(next, new_cost));
+            PushEvent(events, SearchEventType::kVisit, next, GetVector(to_parent));
         }
     }
-    // Release GUI processing
-    gui_busy = false;
 }
+
+template <typename Grid, typename Layout>
+void BasicSearch<Grid, Layout>::PushFrontier(Coordinates at, double priority) {
+    auto& frontier = workspace_.Frontier();
+    frontier.emplace_back(at, priority);
+    CountCell(counters_.pushes, at);
+    stats_.frontier_peak = std::max(stats_.frontier_peak, frontier.size());
+}
+
+template <typename Grid, typename Layout>
+std::pair<Coordinates, double> BasicSearch<Grid, Layout>::PopFrontier() {
+    auto& frontier = workspace_.Frontier();
+    std::sort(frontier.begin(), frontier.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+    const auto entry = frontier.back();
+    frontier.pop_back();
+    return entry;
+}
+
+template <typename Grid, typename Layout>
+double BasicSearch<Grid, Layout>::Priority(Coordinates at, double cost) {
+    // Dijkstra orders by cost so far, A* adds the distance still to go
+    return algorithm_ == Algorithm::kAStar ? cost + Heuristic(at, goal_) : cost;
+}
+
+template class BasicSearch<GridSnapshot, RowMajorLayout>;
+template class BasicSearch<GridSnapshot, TiledLayout>;
+template class BasicSearch<BitGridView, RowMajorLayout>;
+template class BasicSearch<BitGridView, TiledLayout>;
@@ -0,0 +1,92 @@
+#include "search_worker.hpp"
+
+#include <utility>
+
+SearchWorker::SearchWorker(SearchEventQueue& events)
+    : events_(events), next_job_id_(1), finished_job_id_(0), stop_(false), thread_(&SearchWorker::Run, this) {}
+
+SearchWorker::~SearchWorker() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+        CancelAllLocked();
+    }
+    cv_.notify_all();
+    thread_.join();
+}
+
+std::uint32_t SearchWorker::Submit(Algorithm algorithm, GridSnapshot grid, Coordinates start, Coordinates goal,
+                                   bool reuse_tree) {
+    std::uint32_t id;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        CancelAllLocked();
+        id = next_job_id_++;
+        if (next_job_id_ == 0) {
+            next_job_id_ = 1;  // 0 is reserved for "no job"
+        }
+        jobs_.push_back(Job{id, algorithm, std::move(grid), start, goal, reuse_tree, CancelToken()});
+    }
+    cv_.notify_all();
+    return id;
+}
+
+void SearchWorker::CancelAll() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    CancelAllLocked();
+}
+
+bool SearchWorker::LatestStats(std::uint32_t job_id, SearchStats& stats, CellCounters* counters) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (job_id == 0 || job_id != finished_job_id_) {
+        return false;
+    }
+    stats = finished_stats_;
+    if (counters != nullptr) {
+        *counters = finished_counters_;
+    }
+    return true;
+}
+
+void SearchWorker::CancelAllLocked() {
+    running_token_.Cancel();
+    jobs_.clear();
+}
+
+void SearchWorker::Run() {
+    PerfCounters perf_counters;  // Per thread, so it is opened here
+    // One search for all jobs, its workspace only grows with the grid and every Begin() starts from clean tables
+    // unless the job asked to grow the previous tree.
+    // The editor grids are small enough to always count the work per cell.
+    Search search;
+    search.SetCountCells(true);
+    search.SetPerfCounters(&perf_counters);
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+        if (stop_) {
+            return;
+        }
+        Job job = std::move(jobs_.front());
+        jobs_.pop_front();
+        running_token_ = job.token;
+        lock.unlock();
+        Execute(job, search);
+        lock.lock();
+    }
+}
+
+void SearchWorker::Execute(Job& job, Search& search) {
+    SearchChannel channel{events_, job.token, job.id, &progress_};
+    progress_.nodes_expanded.store(0, std::memory_order_relaxed);
+    progress_.memory_bytes.store(0, std::memory_order_relaxed);
+    search.SetReuseTree(job.reuse_tree);
+    search.Begin(job.algorithm, std::move(job.grid), job.start, job.goal);
+    search.Play(channel);
+    if (search.IsDone()) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        finished_job_id_ = job.id;
+        finished_stats_ = search.Stats();
+        finished_counters_ = search.Counters();
+    }
+}
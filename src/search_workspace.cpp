@@ -0,0 +1,73 @@
+#include "search_workspace.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+void MonotonicArena::Reset(std::size_t min_capacity) {
+    if (blocks_.size() > 1 || capacity_ < min_capacity) {
+        capacity_ = std::max(capacity_, min_capacity);
+        blocks_.clear();
+        blocks_.push_back(NewBlock(capacity_));
+    }
+    used_ = 0;
+}
+
+MonotonicArena::Block MonotonicArena::NewBlock(std::size_t size) {
+    // calloc() aligns for every fundamental type and leaves fresh pages to the kernel's zero page
+    auto* memory = static_cast<std::byte*>(std::calloc(std::max<std::size_t>(size, 1), 1));
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    return Block{std::unique_ptr<std::byte, Free>(memory), size, 0};
+}
+
+void* MonotonicArena::AllocateBytes(std::size_t bytes, std::size_t alignment, bool zeroed) {
+    std::size_t offset = (used_ + alignment - 1) / alignment * alignment;
+    if (blocks_.empty() || offset + bytes > blocks_.back().size) {
+        const std::size_t size = std::max(bytes, capacity_);
+        blocks_.push_back(NewBlock(size));
+        capacity_ += size;
+        offset = 0;
+    }
+    Block& block = blocks_.back();
+    std::byte* memory = block.memory.get() + offset;
+    if (zeroed && offset < block.dirty) {
+        std::memset(memory, 0, std::min(block.dirty, offset + bytes) - offset);
+    }
+    block.dirty = std::max(block.dirty, offset + bytes);
+    used_ = offset + bytes;
+    return memory;
+}
+
+template <typename Layout>
+void BasicSearchWorkspace<Layout>::Begin(int width, int height, bool bfs) {
+    layout_.Reset(width, height);
+    const std::size_t cells = layout_.Size();
+    if (cells > reached_.Size() || (bfs ? queue_ == nullptr : costs_ == nullptr)) {
+        // Keeps what earlier queries needed, so alternating engines doesn't lay out the arena again and again.
+        // Largest alignment first, then the parts fit back to back.
+        const std::size_t capacity = std::max(cells, reached_.Size());
+        const bool with_costs = !bfs || costs_ != nullptr;
+        const bool with_queue = bfs || queue_ != nullptr;
+        arena_.Reset((with_costs ? capacity * sizeof(double) : 0) + EpochArray<Visit>::BytesFor(capacity) +
+                     (with_queue ? capacity * sizeof(std::uint32_t) : 0) + (capacity + 3) / 4);
+        costs_ = with_costs ? arena_.Allocate<double>(capacity) : nullptr;
+        reached_.Allocate(arena_, capacity);
+        queue_ = with_queue ? arena_.Allocate<std::uint32_t>(capacity) : nullptr;
+        parents_ = arena_.Allocate<std::uint8_t>((capacity + 3) / 4);
+    } else {
+        reached_.Clear();
+    }
+    queue_head_ = queue_tail_ = 0;
+    frontier_.clear();
+    path_.clear();
+}
+
+template <typename Layout>
+std::size_t BasicSearchWorkspace<Layout>::MemoryBytes() const {
+    return arena_.Capacity() + frontier_.capacity() * sizeof(frontier_.front()) + path_.capacity() * sizeof(Coordinates);
+}
+
+template class BasicSearchWorkspace<RowMajorLayout>;
+template class BasicSearchWorkspace<TiledLayout>;
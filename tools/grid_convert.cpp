@@ -0,0 +1,26 @@
+// Converts a MovingAI .map file into the memory-mappable grid format of grid_file.hpp.
+//
+// Usage: grid_convert IN.map OUT.spgrid
+
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+
+#include "grid_file.hpp"
+#include "movingai.hpp"
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::fprintf(stderr, "usage: grid_convert IN.map OUT.spgrid\n");
+        return EXIT_FAILURE;
+    }
+    try {
+        OccupancyGrid grid = LoadMovingAiMap(argv[1]);
+        WriteGridFile(argv[2], grid.Snapshot());
+        std::printf("%s: %dx%d\n", argv[2], grid.Width(), grid.Height());
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "error: %s\n", e.what());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}